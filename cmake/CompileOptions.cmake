@@ -134,6 +134,13 @@ if ("${CMAKE_CXX_COMPILER_ID}" MATCHES "GNU" OR "${CMAKE_CXX_COMPILER_ID}" MATCH
                 -mbmi2
                 )
     endif()
+
+    # wider SIMD registers for the batched type 1 kernel and hypergirgs::batch_math; no FMA to keep results identical to the scalar code
+    if(OPTION_USE_AVX2)
+        set(DEFAULT_COMPILE_OPTIONS ${DEFAULT_COMPILE_OPTIONS}
+                -mavx2
+                )
+    endif()
 endif ()
 
 
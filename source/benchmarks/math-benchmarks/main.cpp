@@ -5,6 +5,7 @@
 #define POINT_WITH_ORIGINAL
 #include <hypergirgs/Generator.h>
 #include <hypergirgs/Point.h>
+#include <hypergirgs/BatchMath.h>
 
 constexpr double kIntToDbl = 1000.;
 volatile double dmy = 0.0;
@@ -58,7 +59,7 @@ UNARY_TRIPLE_BENCHMARK(sin)
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 
-using Point = hypergirgs::Point;
+using Point = hypergirgs::Point<>;
 
 struct EdgeProbBase {
     EdgeProbBase(double T, double R, double maxProb) : m_T(T), m_R(R), m_maxProb(maxProb) {}
@@ -107,7 +108,7 @@ static void BM_edge_prob(benchmark::State& state) {
 
     Impl base{2.0, R, 1e-5};
 
-    std::vector<hypergirgs::Point> points;
+    std::vector<Point> points;
     points.reserve(n);
     {
         const auto angles = hypergirgs::sampleAngles(n, 1, false);
@@ -129,6 +130,50 @@ BENCHMARK_TEMPLATE(BM_edge_prob, EdgeProbBase);
 BENCHMARK_TEMPLATE(BM_edge_prob, EdgeProbNaive);
 BENCHMARK_TEMPLATE(BM_edge_prob, EdgeProbSimplified);
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// precomputation of the Point terms: one call of the libm functions per term vs. batch_math::pointTerms
+static void BM_point_terms_libm(benchmark::State& state) {
+    constexpr auto n = hypergirgs::batch_math::batch_size;
+    const auto radii = hypergirgs::sampleRadii(n, 0.75, 30.0, 1, false);
+    const auto angles = hypergirgs::sampleAngles(n, 2, false);
+    std::vector<double> invsinh_r(n), coth_r(n), cos_phi(n), sin_phi(n);
+
+    for(auto _ : state) {
+        for(unsigned k = 0; k != n; ++k) {
+            invsinh_r[k] = 1.0 / std::sinh(radii[k]);
+            coth_r[k] = std::cosh(radii[k]) / std::sinh(radii[k]);
+            cos_phi[k] = std::cos(angles[k]);
+            sin_phi[k] = std::sin(angles[k]);
+        }
+        benchmark::DoNotOptimize(invsinh_r.data());
+        benchmark::DoNotOptimize(coth_r.data());
+        benchmark::DoNotOptimize(cos_phi.data());
+        benchmark::DoNotOptimize(sin_phi.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_point_terms_batched(benchmark::State& state) {
+    constexpr auto n = hypergirgs::batch_math::batch_size;
+    const auto radii = hypergirgs::sampleRadii(n, 0.75, 30.0, 1, false);
+    const auto angles = hypergirgs::sampleAngles(n, 2, false);
+    std::vector<double> invsinh_r(n), coth_r(n), cos_phi(n), sin_phi(n);
+
+    for(auto _ : state) {
+        hypergirgs::batch_math::pointTerms(radii.data(), angles.data(), n,
+            invsinh_r.data(), coth_r.data(), cos_phi.data(), sin_phi.data());
+        benchmark::DoNotOptimize(invsinh_r.data());
+        benchmark::DoNotOptimize(coth_r.data());
+        benchmark::DoNotOptimize(cos_phi.data());
+        benchmark::DoNotOptimize(sin_phi.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_point_terms_libm);
+BENCHMARK(BM_point_terms_batched);
+
 
 
 BENCHMARK_MAIN();
@@ -6,11 +6,15 @@
 #include <cstring>
 #include <fstream>
 #include <algorithm>
+#include <limits>
 
 #include <omp.h>
 
 #include <girgs/girgs-version.h>
 #include <girgs/Generator.h>
+#include <girgs/BinaryFormat.h>
+#include <girgs/TextFormat.h>
+#include <girgs/GraphStatistics.h>
 #include <girgs/BitManipulation.h>
 
 
@@ -48,6 +52,57 @@ void rangeCheck(T value, T min, T max, string name, bool lex = false, bool hex =
     logParam(value, name);
 }
 
+template<typename Statistics>
+void writeStatistics(const Statistics& statistics, const string& file) {
+    cout << "\nstatistics:\n";
+    logParam(statistics.numEdges(), "edges");
+    logParam(statistics.averageDegree(), "avg deg");
+    logParam(statistics.maxDegree(), "max deg");
+    logParam(statistics.histogram()[0], "isolated");
+
+    cout << "writing degree histogram (.hist) ...\t" << flush;
+    auto t6 = high_resolution_clock::now();
+    ofstream f{file+".hist"};
+    if(!f.is_open()) throw std::runtime_error{"Error: failed to open file \"" + file + ".hist\""};
+    const auto& histogram = statistics.histogram();
+    for (size_t degree = 0; degree < histogram.size(); ++degree)
+        if (histogram[degree])
+            f << degree << ' ' << histogram[degree] << '\n';
+    auto t7 = high_resolution_clock::now();
+    cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+}
+
+
+template<typename EdgeList>
+void writeOutput(const EdgeList& edges, const girgs::BinaryHeader& header, const vector<double>& weights, const vector<double>& positions,
+                 const string& file, bool dot, bool edge, bool bin) {
+    const auto n = static_cast<long long>(header.n);
+    const auto d = static_cast<int>(header.dimension);
+    if (dot) {
+        cout << "writing .dot file ...\t\t" << flush;
+        auto t6 = high_resolution_clock::now();
+        girgs::saveDot(weights, positions.data(), d, d, edges, file+".dot");
+        auto t7 = high_resolution_clock::now();
+        cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+    }
+
+    if (edge) {
+        cout << "writing edge list (.txt) ...\t" << flush;
+        auto t6 = high_resolution_clock::now();
+        girgs::saveEdgeList(edges, n, file+".txt");
+        auto t7 = high_resolution_clock::now();
+        cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+    }
+
+    if (bin) {
+        cout << "writing binary (.bin) ...\t" << flush;
+        auto t6 = high_resolution_clock::now();
+        girgs::saveBinary(file+".bin", header, edges, weights.data(), positions.data());
+        auto t7 = high_resolution_clock::now();
+        cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+    }
+}
+
 
 
 int main(int argc, char* argv[]) {
@@ -56,6 +111,7 @@ int main(int argc, char* argv[]) {
     if (argc < 2 || 0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-help")) {
         clog << "usage: ./gengirg\n"
             << "\t\t[-n anInt]          // number of nodes                          default 10000\n"
+            << "\t\t[-ids64 0|1]        // 64 bit node ids (forced if n >= 2^31-1)  default 0\n"
             << "\t\t[-d anInt]          // dimension of geometry    range [1,5]     default 1\n"
             << "\t\t[-ple aFloat]       // power law exponent       range (2,3]     default 2.5\n"
             << "\t\t[-alpha aFloat]     // model parameter          range (1,inf]   default infinity\n"
@@ -66,7 +122,10 @@ int main(int argc, char* argv[]) {
             << "\t\t[-threads anInt]    // number of threads to use                 default 1\n"
             << "\t\t[-file aString]     // file name for output (w/o ext)           default \"graph\"\n"
             << "\t\t[-dot 0|1]          // write result as dot (.dot)               default 0\n"
-            << "\t\t[-edge 0|1]         // write result as edgelist (.txt)          default 0\n";
+            << "\t\t[-edge 0|1]         // write result as edgelist (.txt)          default 0\n"
+            << "\t\t[-bin 0|1]          // write result as binary (.bin)            default 0\n"
+            << "\t\t[-stats 0|1]        // only degree statistics (.hist), no edges default 0\n"
+            << "\t\t[-nooutput 0|1]     // only count edges, no output              default 0\n";
         return 0;
     }
 
@@ -83,7 +142,7 @@ int main(int argc, char* argv[]) {
 
     // read params
     auto params = parseArgs(argc, argv);
-    auto n      = !params["n"    ].empty()  ? stoi(params["n"    ]) : 10000;
+    auto n      = !params["n"    ].empty()  ? stoll(params["n"    ]) : 10000ll;
     auto d      = !params["d"    ].empty()  ? stoi(params["d"    ]) : 1;
     auto ple    = !params["ple"  ].empty()  ? stod(params["ple"  ]) : 2.5;
     auto alpha  = !params["alpha"].empty()  ? stod(params["alpha"]) : std::numeric_limits<double>::infinity();
@@ -95,10 +154,15 @@ int main(int argc, char* argv[]) {
     auto file   = !params["file" ].empty()  ? params["file"] : "graph";
     auto dot    = params["dot" ] == "1";
     auto edge   = params["edge"] == "1";
+    auto bin    = params["bin" ] == "1";
+    auto stats  = params["stats"] == "1";
+    auto nooutput = params["nooutput"] == "1";
+    auto ids64  = params["ids64"] == "1" || n >= numeric_limits<int>::max();
 
     // log params and range checks
     cout << "using:\n";
     logParam(n, "n");
+    logParam(ids64, "ids64");
     rangeCheck(d, 1, 5, "d");
     rangeCheck(ple, 2.0, 3.0, "ple", true, false);
     rangeCheck(alpha, 1.0, std::numeric_limits<double>::infinity(), "alpha", true);
@@ -111,6 +175,9 @@ int main(int argc, char* argv[]) {
     logParam(file, "file");
     logParam(dot, "dot");
     logParam(edge, "edge");
+    logParam(bin, "bin");
+    logParam(stats, "stats");
+    logParam(nooutput, "nooutput");
     logParam(girgs::BitManipulation<1>::name(), "morton");
     cout << "\n";
 
@@ -125,7 +192,9 @@ int main(int argc, char* argv[]) {
 
 
     cout << "generating positions ...\t" << flush;
-    auto positions = girgs::generatePositions(n, d, pseed);
+    // flat row-major buffer, i.e. no allocation per node
+    auto positions = vector<double>(n * d);
+    girgs::generatePositions(n, d, pseed, positions.data(), d);
     auto t3 = high_resolution_clock::now();
     cout << "done in " << duration_cast<milliseconds>(t3 - t2).count() << "ms" << endl;
 
@@ -136,29 +205,66 @@ int main(int argc, char* argv[]) {
     cout << "done in " << duration_cast<milliseconds>(t4 - t3).count() << "ms\tscaling = " << scaling << endl;
 
     cout << "sampling edges ...\t\t" << flush;
-    auto edges = girgs::generateEdges(weights, positions, alpha, sseed);
+    vector<pair<int, int>> edges;
+    vector<pair<int64_t, int64_t>> edges64;
+    // in the stats and nooutput modes the edges are not stored
+    // the degree counters are as wide as the node ids
+    girgs::GraphStatistics<int> statistics(stats && !ids64 ? n : 0);
+    girgs::GraphStatistics<int64_t> statistics64(stats && ids64 ? n : 0);
+    girgs::EdgeCounter counter;
+    uint64_t num_edges;
+    if (stats) {
+        if (ids64) {
+            girgs::generateEdges<int64_t>(weights, positions.data(), d, d, alpha, sseed, statistics64);
+            statistics64.finalize();
+            num_edges = statistics64.numEdges();
+        } else {
+            girgs::generateEdges<int>(weights, positions.data(), d, d, alpha, sseed, statistics);
+            statistics.finalize();
+            num_edges = statistics.numEdges();
+        }
+    } else if (nooutput) {
+        if (ids64)
+            girgs::generateEdges<int64_t>(weights, positions.data(), d, d, alpha, sseed, counter);
+        else
+            girgs::generateEdges<int>(weights, positions.data(), d, d, alpha, sseed, counter);
+        num_edges = counter.numEdges();
+    } else if (ids64) {
+        edges64 = girgs::generateEdges64(weights, positions.data(), d, d, alpha, sseed);
+        num_edges = edges64.size();
+    } else {
+        edges = girgs::generateEdges(weights, positions.data(), d, d, alpha, sseed);
+        num_edges = edges.size();
+    }
     auto t5 = high_resolution_clock::now();
-    cout << "done in " << duration_cast<milliseconds>(t5 - t4).count() << "ms\tavg deg = " << edges.size()*2.0/n << endl;
+    cout << "done in " << duration_cast<milliseconds>(t5 - t4).count() << "ms\tavg deg = " << num_edges*2.0/n << endl;
 
-    if (dot) {
-        cout << "writing .dot file ...\t\t" << flush;
-        auto t6 = high_resolution_clock::now();
-        girgs::saveDot(weights, positions, edges, file+".dot");
-        auto t7 = high_resolution_clock::now();
-        cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+    if (stats) {
+        if (ids64)
+            writeStatistics(statistics64, file);
+        else
+            writeStatistics(statistics, file);
+        return 0;
     }
+    if (nooutput)
+        return 0;
 
-    if (edge) {
-        cout << "writing edge list (.txt) ...\t" << flush;
-        auto t6 = high_resolution_clock::now();
-        ofstream f{file+".txt"};
-        if(!f.is_open()) throw std::runtime_error{"Error: failed to open file \"" + file + ".txt\""};
-        f << n << ' ' << edges.size() << "\n\n";
-        for(auto& each : edges)
-            f << each.first << ' ' << each.second << '\n';
-        auto t7 = high_resolution_clock::now();
-        cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
-    }
+    girgs::BinaryHeader header;
+    header.model = girgs::BinaryHeader::girg;
+    header.n = n;
+    header.dimension = d;
+    header.alpha = alpha;
+    header.ple = ple;
+    header.avg_degree = deg;
+    header.weight_scaling = scaling;
+    header.seeds[0] = wseed;
+    header.seeds[1] = pseed;
+    header.seeds[2] = sseed;
+
+    if (ids64)
+        writeOutput(edges64, header, weights, positions, file, dot, edge, bin);
+    else
+        writeOutput(edges, header, weights, positions, file, dot, edge, bin);
 
     return 0;
 }
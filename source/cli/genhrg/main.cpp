@@ -5,12 +5,16 @@
 #include <string>
 #include <cstring>
 #include <fstream>
-#include <iomanip>
+#include <limits>
 
 #include <omp.h>
 
 #include <girgs/girgs-version.h>
+#include <girgs/BinaryFormat.h>
+#include <girgs/TextFormat.h>
 #include <hypergirgs/Generator.h>
+#include <hypergirgs/GraphStatistics.h>
+#include <hypergirgs/HyperbolicTree.h>
 
 
 using namespace std;
@@ -47,6 +51,36 @@ void rangeCheck(T value, T min, T max, string name, bool lex = false, bool hex =
     logParam(value, name);
 }
 
+template<typename Statistics>
+void writeStatistics(const Statistics& statistics, const string& file) {
+    cout << "\nstatistics:\n";
+    logParam(statistics.numEdges(), "edges");
+    logParam(statistics.averageDegree(), "avg deg");
+    logParam(statistics.maxDegree(), "max deg");
+    logParam(statistics.histogram()[0], "isolated");
+
+    cout << "writing degree histogram (.hist) ...\t" << flush;
+    auto t6 = high_resolution_clock::now();
+    ofstream f{file+".hist"};
+    if(!f.is_open()) throw std::runtime_error{"Error: failed to open file \"" + file + ".hist\""};
+    const auto& histogram = statistics.histogram();
+    for (size_t degree = 0; degree < histogram.size(); ++degree)
+        if (histogram[degree])
+            f << degree << ' ' << histogram[degree] << '\n';
+    auto t7 = high_resolution_clock::now();
+    cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+}
+
+
+template<typename EdgeList>
+void writeEdgeList(const EdgeList& edges, long long n, const string& file) {
+    cout << "writing edge list (.txt) ...\t" << flush;
+    auto t6 = high_resolution_clock::now();
+    girgs::saveEdgeList(edges, n, file+".txt");
+    auto t7 = high_resolution_clock::now();
+    cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
+}
+
 
 
 int main(int argc, char* argv[]) {
@@ -55,6 +89,7 @@ int main(int argc, char* argv[]) {
     if (argc < 2 || 0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-help")) {
         clog << "usage: ./genhrg\n"
             << "\t\t[-n anInt]          // number of nodes                          default 10000\n"
+            << "\t\t[-ids64 0|1]        // 64 bit node ids (forced if n >= 2^31-1)  default 0\n"
             << "\t\t[-alpha aFloat]     // model parameter          range [0.5,1]   default 0.75\n"
             << "\t\t[-t aFloat]         // temperature parameter    range [0,1)     default 0\n"
             << "\t\t[-deg aFloat]       // average degree           range [1,n)     default 10\n"
@@ -65,7 +100,10 @@ int main(int argc, char* argv[]) {
             << "\t\t[-nkr 0|1]          // use NetworKit R estimation               default 0\n"
             << "\t\t[-file aString]     // file name for output (w/o ext)           default \"graph\"\n"
             << "\t\t[-edge 0|1]         // write result as edgelist (.txt)          default 0\n"
-            << "\t\t[-coord 0|1]        // write hyp. coordinates (.hyp)            default 0\n";
+            << "\t\t[-coord 0|1]        // write hyp. coordinates (.hyp)            default 0\n"
+            << "\t\t[-bin 0|1]          // write result as binary (.bin)            default 0\n"
+            << "\t\t[-stats 0|1]        // only degree statistics (.hist), no edges default 0\n"
+            << "\t\t[-nooutput 0|1]     // only count edges, no output              default 0\n";
         return 0;
     }
 
@@ -82,7 +120,7 @@ int main(int argc, char* argv[]) {
 
     // read params
     auto params = parseArgs(argc, argv);
-    auto n      = !params["n"    ].empty()  ? stoi(params["n"    ]) : 10000;
+    auto n      = !params["n"    ].empty()  ? stoll(params["n"    ]) : 10000ll;
     auto alpha  = !params["alpha"].empty()  ? stod(params["alpha"]) : 0.75;
     auto T      = !params["t"    ].empty()  ? stod(params["t"    ]) : 0;
     auto deg    = !params["deg"  ].empty()  ? stod(params["deg"  ]) : 10.0;
@@ -94,10 +132,15 @@ int main(int argc, char* argv[]) {
     auto file   = !params["file" ].empty()  ? params["file"] : "graph";
     auto edge   = params["edge" ] == "1";
     auto coord  = params["coord"] == "1";
+    auto bin    = params["bin"  ] == "1";
+    auto stats  = params["stats"] == "1";
+    auto nooutput = params["nooutput"] == "1";
+    auto ids64  = params["ids64"] == "1" || n >= numeric_limits<int>::max();
 
     // log params and range checks
     cout << "using:\n";
     logParam(n, "n");
+    logParam(ids64, "ids64");
     rangeCheck(alpha, 0.5, 1.0, "alpha");
     rangeCheck(T, 0.0, 1.0, "t", false, true);
     rangeCheck(deg, 1.0, n-1.0, "deg");
@@ -110,6 +153,9 @@ int main(int argc, char* argv[]) {
     logParam(file, "file");
     logParam(edge, "edge");
     logParam(coord, "coord");
+    logParam(bin, "bin");
+    logParam(stats, "stats");
+    logParam(nooutput, "nooutput");
     cout << "\n";
 
     cout << "estimate R ...\t\t" << flush;
@@ -130,30 +176,85 @@ int main(int argc, char* argv[]) {
     cout << "done in " << duration_cast<milliseconds>(t3 - t2).count() << "ms" << endl;
 
     cout << "sampling edges ...\t" << flush;
-    auto edges = hypergirgs::generateEdges(radii, angles, T, R, sseed);
+    vector<pair<int, int>> edges;
+    vector<pair<int64_t, int64_t>> edges64;
+    // in the stats and nooutput modes the edges are not stored
+    // the degree counters are as wide as the node ids
+    hypergirgs::GraphStatistics<int> statistics(stats && !ids64 ? n : 0);
+    hypergirgs::GraphStatistics<int64_t> statistics64(stats && ids64 ? n : 0);
+    hypergirgs::EdgeCounter counter;
+    uint64_t num_edges;
+    if (stats) {
+        if (ids64) {
+            hypergirgs::makeHyperbolicTree<hypergirgs::Xoshiro256PlusPlus, int64_t>(radii, angles, T, R, statistics64).generate(sseed);
+            statistics64.finalize();
+            num_edges = statistics64.numEdges();
+        } else {
+            hypergirgs::makeHyperbolicTree<hypergirgs::Xoshiro256PlusPlus, int>(radii, angles, T, R, statistics).generate(sseed);
+            statistics.finalize();
+            num_edges = statistics.numEdges();
+        }
+    } else if (nooutput) {
+        if (ids64)
+            hypergirgs::makeHyperbolicTree<hypergirgs::Xoshiro256PlusPlus, int64_t>(radii, angles, T, R, counter).generate(sseed);
+        else
+            hypergirgs::makeHyperbolicTree<hypergirgs::Xoshiro256PlusPlus, int>(radii, angles, T, R, counter).generate(sseed);
+        num_edges = counter.numEdges();
+    } else if (ids64) {
+        edges64 = hypergirgs::generateEdges64(radii, angles, T, R, sseed);
+        num_edges = edges64.size();
+    } else {
+        edges = hypergirgs::generateEdges(radii, angles, T, R, sseed);
+        num_edges = edges.size();
+    }
     auto t5 = high_resolution_clock::now();
-    cout << "done in " << duration_cast<milliseconds>(t5 - t3).count() << "ms\tavg deg = " << edges.size()*2.0/n << endl;
+    cout << "done in " << duration_cast<milliseconds>(t5 - t3).count() << "ms\tavg deg = " << num_edges*2.0/n << endl;
+
+    if (stats) {
+        if (ids64)
+            writeStatistics(statistics64, file);
+        else
+            writeStatistics(statistics, file);
+        return 0;
+    }
+    if (nooutput)
+        return 0;
 
     if (edge) {
-        cout << "writing edge list (.txt) ...\t" << flush;
+        if (ids64)
+            writeEdgeList(edges64, n, file);
+        else
+            writeEdgeList(edges, n, file);
+    }
+
+    if (coord) {
+        cout << "writing coordinates (.hyp) ...\t" << flush;
         auto t6 = high_resolution_clock::now();
-        ofstream f{file+".txt"};
-        if(!f.is_open()) throw std::runtime_error{"Error: failed to open file \"" + file + ".txt\""};
-        f << n << ' ' << edges.size() << "\n\n";
-        for(auto& each : edges)
-            f << each.first << ' ' << each.second << '\n';
+        girgs::saveColumns({radii.data(), angles.data()}, n, file+".hyp");
         auto t7 = high_resolution_clock::now();
         cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
     }
 
-    if (coord) {
-        cout << "writing coordinates (.hyp) ...\t" << flush;
+    if (bin) {
+        girgs::BinaryHeader header;
+        header.model = girgs::BinaryHeader::hyperbolic;
+        header.n = n;
+        header.dimension = 1;
+        header.alpha = alpha;
+        header.ple = 2*alpha+1;
+        header.avg_degree = deg;
+        header.temperature = T;
+        header.radius = R;
+        header.seeds[0] = rseed;
+        header.seeds[1] = aseed;
+        header.seeds[2] = sseed;
+
+        cout << "writing binary (.bin) ...\t" << flush;
         auto t6 = high_resolution_clock::now();
-        ofstream f{file+".hyp"};
-        if(!f.is_open()) throw std::runtime_error{"Error: failed to open file \"" + file + ".hyp\""};
-        f << std::fixed << std::setprecision(6);
-        for(auto i{0u}; i<n; ++i)
-            f << radii[i]  << ' ' << angles[i] << '\n';
+        if (ids64)
+            girgs::saveBinary(file+".bin", header, edges64, radii.data(), angles.data());
+        else
+            girgs::saveBinary(file+".bin", header, edges, radii.data(), angles.data());
         auto t7 = high_resolution_clock::now();
         cout << "done in " << duration_cast<milliseconds>(t7 - t6).count() << "ms" << endl;
     }
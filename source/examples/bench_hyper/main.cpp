@@ -4,6 +4,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <tuple>
 
 #include <hypergirgs/HyperbolicTree.h>
 #include <hypergirgs/Generator.h>
@@ -29,7 +31,8 @@ static std::string hostname() {
 
 
 
-double benchmark(std::ostream& os, const std::string& host, unsigned int iter, unsigned int n, unsigned int avgDeg, double alpha, double T, unsigned int seed = 0) {
+double benchmark(std::ostream& os, const std::string& host, unsigned int iter, unsigned int n, unsigned int avgDeg, double alpha, double T,
+                 double layer_height, unsigned int seed = 0) {
     CounterPerThread<uint64_t> counter_num_edges;
 
     double time_total, time_points, time_preprocess, time_sample;
@@ -50,8 +53,9 @@ double benchmark(std::ostream& os, const std::string& host, unsigned int iter, u
         auto addEdge = [&counter_num_edges] (int, int, int tid) {counter_num_edges.add(tid);};
         hypergirgs::HyperbolicTree<decltype(addEdge)> generator = [&] {
             ScopedTimer timer("Preprocess", time_preprocess);
-            return hypergirgs::makeHyperbolicTree(radii, angles, T, R, addEdge, true);
+            return hypergirgs::makeHyperbolicTree(radii, angles, T, R, addEdge, true, layer_height);
         }();
+        layer_height = generator.layerHeight();
 
         // Generate edges
         {
@@ -81,7 +85,8 @@ double benchmark(std::ostream& os, const std::string& host, unsigned int iter, u
            << time_preprocess << ","
            << time_sample << ","
            << num_edges << ","
-           << (2.0 * num_edges / n);
+           << (2.0 * num_edges / n) << ","
+           << layer_height;
 
         os << ss.str() << std::endl;
     }
@@ -89,11 +94,13 @@ double benchmark(std::ostream& os, const std::string& host, unsigned int iter, u
     return time_total;
 }
 
+// usage: bench_hyper [layer_height [n_max]]; a layer height <= 0 (default) is chosen automatically
 int main(int argc, char* argv[]) {
     unsigned int seed = 0;
 
+    const double layer_height = argc > 1 ? std::atof(argv[1]) : 0.0;
     const unsigned n0 = 1e4;
-    const unsigned nMax = 1e8;
+    const unsigned nMax = argc > 2 ? static_cast<unsigned>(std::atof(argv[2])) : static_cast<unsigned>(1e8);
     const unsigned steps_per_dec = 3;
     const double timeout = 100 * 1e3; // ms
 
@@ -116,7 +123,8 @@ int main(int argc, char* argv[]) {
           "TimePrepro,"
           "TimeEdges,"
           "GenNumEdge,"
-          "GenAvgDeg\n";
+          "GenAvgDeg,"
+          "LayerHeight\n";
 
     const auto host = hostname();
 
@@ -140,7 +148,7 @@ int main(int argc, char* argv[]) {
                         if (n < skip_n) {
                             // if last (smaller) problem took too long, we skip this one
                             // we do not use break to make sure seed stays consistent
-                            time = benchmark(std::cerr, host, iter, n, avgDeg, alpha, T, seed);
+                            time = benchmark(std::cerr, host, iter, n, avgDeg, alpha, T, layer_height, seed);
                             if (time > timeout) {
                                 skip_n = n;
                                 std::cout << " took too long\n";
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+
+#include <hypergirgs/HyperbolicTree.h>
+#include <hypergirgs/Generator.h>
+
+// Compares the load balance of the task decompositions of HyperbolicTree::generate().
+// Each task is timed on its own (the fastest of two runs, to filter out interruptions), then the run on P threads
+// is simulated: whenever a thread is idle it takes the next task.
+// The tail is the makespan relative to a perfect balance (total / P), i.e. the time the last thread finishes
+// after the average one; memory contention is not modelled.
+
+using Tree = hypergirgs::HyperbolicTree<void(*)(int, int, int)>;
+using Task = hypergirgs::TaskDescription;
+
+static void ignoreEdge(int, int, int) {}
+
+// The decomposition of generate() before the cost model: the cell pairs above first_parallel_level = ceil(log2(2P))
+// are sampled round-robin by P-1 threads while one thread collects the subtrees of first_parallel_level,
+// which are then processed with the expensive ones (cellA == cellB) first.
+static void fixedLevelTasks(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int first_parallel_level,
+                            unsigned int levels, std::vector<Task>& top, std::vector<Task>& subtrees) {
+    if (level == first_parallel_level) {
+        subtrees.emplace_back(cellA, cellB, level, true, 0.0);
+        return;
+    }
+
+    top.emplace_back(cellA, cellB, level, false, 0.0);
+    if (!hypergirgs::AngleHelper::touching(cellA, cellB, level) || level + 1 == levels)
+        return;
+
+    const auto fA = hypergirgs::AngleHelper::firstChild(cellA);
+    const auto fB = hypergirgs::AngleHelper::firstChild(cellB);
+    fixedLevelTasks(fA + 0, fB + 0, level + 1, first_parallel_level, levels, top, subtrees);
+    fixedLevelTasks(fA + 0, fB + 1, level + 1, first_parallel_level, levels, top, subtrees);
+    fixedLevelTasks(fA + 1, fB + 1, level + 1, first_parallel_level, levels, top, subtrees);
+    if (cellA != cellB)
+        fixedLevelTasks(fA + 1, fB + 0, level + 1, first_parallel_level, levels, top, subtrees);
+}
+
+static std::vector<double> timeTasks(const Tree& tree, const std::vector<Task>& tasks, uint64_t seed) {
+    std::vector<double> times(tasks.size(), std::numeric_limits<double>::infinity());
+    for (auto run = 0; run < 2; ++run) {
+        for (size_t k = 0; k < tasks.size(); ++k) {
+            const auto start = std::chrono::steady_clock::now();
+            tree.sampleTask(tasks[k], seed);
+            const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            times[k] = std::min(times[k], time);
+        }
+    }
+    return times;
+}
+
+// list scheduling of the tasks in the given order; returns the makespan
+static double simulate(std::vector<double> loads, const std::vector<double>& times) {
+    for (auto time : times)
+        *std::min_element(loads.begin(), loads.end()) += time;
+    return *std::max_element(loads.begin(), loads.end());
+}
+
+static void report(const char* decomposition, int n, int avgDeg, double alpha, double T, int threads,
+                   size_t num_tasks, double total, double makespan) {
+    std::stringstream ss;
+    ss << "[CSV]" << decomposition << ","
+       << n << "," << avgDeg << "," << alpha << "," << T << "," << threads << ","
+       << num_tasks << "," << total << "," << makespan << "," << (total / threads) << ","
+       << (makespan / (total / threads));
+    std::cout << ss.str() << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const auto n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const uint64_t seed = 1400;
+
+    std::cout << "[CSV]decomposition,n,avgDeg,alpha,T,threads,tasks,TimeTotal,Makespan,Ideal,Tail\n";
+
+    for (const double T : {0.0, 0.5}) {
+        for (const double ple : {2.2, 3.0}) {
+            const auto alpha = (ple - 1.0) / 2.0;
+            for (const int avgDeg : {10, 100}) {
+                const auto R = hypergirgs::calculateRadius(n, alpha, T, avgDeg);
+                auto radii_angles = hypergirgs::sampleRadiiAndAngles(n, alpha, R, 12);
+                auto callback = &ignoreEdge;
+                Tree tree(radii_angles.first, radii_angles.second, T, R, callback);
+
+                for (const int threads : {8, 32, 128}) {
+                    // before: cut at a fixed level
+                    {
+                        const auto first_parallel_level = static_cast<unsigned int>(std::ceil(std::log2(2 * threads)));
+                        std::vector<Task> top, subtrees;
+                        fixedLevelTasks(0, 0, 0, first_parallel_level, tree.levels(), top, subtrees);
+                        std::partition(subtrees.begin(), subtrees.end(), [] (const Task& t) { return t.cellA == t.cellB; });
+
+                        const auto top_times = timeTasks(tree, top, seed);
+                        const auto subtree_times = timeTasks(tree, subtrees, seed);
+                        std::vector<double> loads(threads, 0.0);
+                        for (size_t k = 0; k < top_times.size(); ++k)
+                            loads[k % (threads - 1)] += top_times[k];
+
+                        const auto total = std::accumulate(top_times.begin(), top_times.end(), 0.0)
+                                         + std::accumulate(subtree_times.begin(), subtree_times.end(), 0.0);
+                        report("FixedLevel", n, avgDeg, alpha, T, threads, top.size() + subtrees.size(),
+                               total, simulate(loads, subtree_times));
+                    }
+
+                    // now: split by estimated cost, LPT order
+                    {
+                        const auto tasks = tree.decompose(threads);
+                        const auto times = timeTasks(tree, tasks, seed);
+                        const auto total = std::accumulate(times.begin(), times.end(), 0.0);
+                        report("CostModel", n, avgDeg, alpha, T, threads, tasks.size(),
+                               total, simulate(std::vector<double>(threads, 0.0), times));
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
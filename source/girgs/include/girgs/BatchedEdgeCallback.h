@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+
+#include <omp.h>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  Edge callback that collects edges in thread local buffers and hands them
+ *  in batches to a user supplied callback.
+ *  It can be passed wherever an EdgeCallback is expected (e.g. generateEdges(..., EdgeCallback&) or SpatialTree).
+ *
+ *  The batch callback is invoked as batchCallback(begin, end, tid) with [begin, end) a range of std::pair<NodeId,NodeId>.
+ *  It is called by the thread that produced the edges, i.e. calls with different tids may happen concurrently.
+ *  The range is only valid during the call.
+ *
+ * @tparam BatchCallback
+ *  Callable with signature void(const std::pair<NodeId,NodeId>*, const std::pair<NodeId,NodeId>*, int).
+ * @tparam NodeId
+ *  Type of the node indices (int or int64_t).
+ */
+template <typename BatchCallback, typename NodeId = int>
+class BatchedEdgeCallback {
+public:
+    using edge_vector = std::vector<std::pair<NodeId, NodeId>>;
+
+    static constexpr size_t default_batch_size = size_t{1} << 20;
+
+    explicit BatchedEdgeCallback(BatchCallback& batchCallback, size_t batch_size = default_batch_size, int max_threads = omp_get_max_threads())
+        : m_batchCallback(batchCallback)
+        , m_batch_size(batch_size)
+        , m_local_edges(max_threads)
+    {
+        assert(batch_size > 0);
+    }
+
+    void operator()(NodeId u, NodeId v, int tid) {
+        assert(0 <= tid && tid < m_local_edges.size());
+        auto& local = m_local_edges[tid].first;
+        local.emplace_back(u, v);
+        if (local.size() == m_batch_size)
+            flush(tid);
+    }
+
+    /// hands the edges buffered by thread tid to the batch callback
+    void flush(int tid) {
+        auto& local = m_local_edges[tid].first;
+        if (local.empty())
+            return;
+        m_batchCallback(local.data(), local.data() + local.size(), tid);
+        local.clear();
+    }
+
+    /// hands all buffered edges to the batch callback; call after the generation finished
+    void flush() {
+        for (int tid = 0; tid < m_local_edges.size(); ++tid)
+            flush(tid);
+    }
+
+private:
+    BatchCallback& m_batchCallback;
+    const size_t m_batch_size;
+
+    std::vector<std::pair<
+            edge_vector,
+            uint64_t[31] /* avoid false sharing */
+    > > m_local_edges;
+};
+
+/// provide automatic type deduction for constructor; the node id type may be chosen explicitly, e.g. makeBatchedEdgeCallback<int64_t>(...)
+template <typename NodeId = int, typename BatchCallback>
+BatchedEdgeCallback<BatchCallback, NodeId> makeBatchedEdgeCallback(BatchCallback& batchCallback,
+        size_t batch_size = BatchedEdgeCallback<BatchCallback, NodeId>::default_batch_size) {
+    return BatchedEdgeCallback<BatchCallback, NodeId>{batchCallback, batch_size};
+}
+
+} // namespace girgs
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <girgs/girgs_api.h>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  Header of the binary graph format written by saveBinary() and the CLIs with -bin 1.
+ *
+ *  A file consists of
+ *   - the header: the fields below in declaration order, each little-endian, 128 bytes in total, no padding,
+ *   - m edges, each as two little-endian signed integers of id_bytes bytes (u then v),
+ *   - if has_nodes: n doubles with the weights (GIRGs) or radii (hyperbolic random graphs),
+ *   - if has_nodes: n*dimension doubles with the coordinates in row-major order,
+ *     i.e. the positions (GIRGs) or angles (hyperbolic random graphs, dimension 1).
+ *  All doubles are little-endian IEEE 754 binary64.
+ *  Model parameters that do not apply to a model are 0.
+ */
+struct BinaryHeader {
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kSize = 128;
+
+    enum Model : uint32_t { girg = 0, hyperbolic = 1 };
+
+    char     magic[8] {'G','I','R','G','S','B','I','N'};
+    uint32_t version {kVersion};
+    uint32_t model {girg};
+    uint32_t id_bytes {4};      ///< 4 or 8; set by saveBinary() from the edge type
+    uint32_t dimension {0};     ///< coordinates per node
+    uint32_t has_nodes {0};     ///< 1 if weights and coordinates follow the edges; set by saveBinary()
+    uint32_t reserved {0};
+    uint64_t n {0};
+    uint64_t m {0};             ///< set by saveBinary()
+    double   alpha {0};
+    double   ple {0};           ///< power law exponent of the weights (hyperbolic: 2*alpha+1)
+    double   avg_degree {0};    ///< desired average degree
+    double   temperature {0};   ///< hyperbolic only
+    double   radius {0};        ///< hyperbolic only: disk radius R
+    double   weight_scaling {0};///< GIRGs only: factor returned by scaleWeights()
+    int64_t  seeds[3] {0,0,0};  ///< GIRGs: weight, position, sampling seed; hyperbolic: radii, angle, sampling seed
+    uint64_t reserved2 {0};
+};
+
+/**
+ * @brief
+ *  A graph read by loadBinary().
+ *  Node ids are always widened to 64 bit.
+ */
+struct BinaryGraph {
+    BinaryHeader header;
+    std::vector<std::pair<int64_t, int64_t>> edges;
+    std::vector<double> weights;     ///< empty if !header.has_nodes
+    std::vector<double> coordinates; ///< empty if !header.has_nodes; node i at [i*dimension, (i+1)*dimension)
+};
+
+/**
+ * @brief
+ *  Saves the graph in the binary format described in BinaryHeader.
+ *  Uses large buffered writes, so this is usually much faster than writing a text edge list.
+ *
+ * @param file
+ *  The name of the output file (with extension).
+ * @param header
+ *  Model parameters and seeds. n and dimension must be set, m, id_bytes and has_nodes are filled in.
+ * @param edges
+ *  An edge list with zero based indices.
+ * @param weights
+ *  n weights (or radii), or nullptr to skip the node data.
+ * @param coordinates
+ *  n*header.dimension coordinates in row-major order (see generatePositions(long long, int, int, double*, size_t, bool)).
+ *  Ignored if weights is nullptr.
+ *
+ * @throw std::runtime_error
+ *  If the file cannot be written.
+ */
+GIRGS_API void saveBinary(const std::string& file, const BinaryHeader& header, const std::vector<std::pair<int,int>>& edges,
+        const double* weights = nullptr, const double* coordinates = nullptr);
+
+/// Same as saveBinary(const std::string&, const BinaryHeader&, const std::vector<std::pair<int,int>>&, const double*, const double*)
+/// for 64 bit node indices; written with id_bytes = 8.
+GIRGS_API void saveBinary(const std::string& file, const BinaryHeader& header, const std::vector<std::pair<int64_t,int64_t>>& edges,
+        const double* weights = nullptr, const double* coordinates = nullptr);
+
+/**
+ * @brief
+ *  Reads a graph written by saveBinary().
+ *
+ * @param file
+ *  The name of the input file (with extension).
+ * @param readNodes
+ *  If false, the weights and coordinates are not read even if present.
+ *
+ * @throw std::runtime_error
+ *  If the file cannot be read, is truncated, or is not in the binary format of this version.
+ */
+GIRGS_API BinaryGraph loadBinary(const std::string& file, bool readNodes = true);
+
+} // namespace girgs
@@ -24,11 +24,12 @@ struct BitPattern {
 #endif
 
 namespace girgs {
+// T is the type of cell ids (uint32_t or uint64_t); coordinates are of the same type
 #ifdef USE_BMI2
-    template <unsigned D>
-    using BitManipulation = BitManipulationDetails::BMI2::Implementation<D>;
+    template <unsigned D, typename T = uint32_t>
+    using BitManipulation = BitManipulationDetails::BMI2::Implementation<D, T>;
 #else
-    template <unsigned D>
-    using BitManipulation = BitManipulationDetails::Generic::Implementation<D>;
+    template <unsigned D, typename T = uint32_t>
+    using BitManipulation = BitManipulationDetails::Generic::Implementation<D, T>;
 #endif
 }
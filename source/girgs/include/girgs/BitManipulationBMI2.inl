@@ -1,30 +1,39 @@
 #pragma once
 
 #include <immintrin.h>
+#include <type_traits>
 
 namespace girgs {
 namespace BitManipulationDetails {
 namespace BMI2 {
-template <unsigned D>
+inline uint32_t pdep(uint32_t x, uint32_t mask) noexcept { return _pdep_u32(x, mask); }
+inline uint64_t pdep(uint64_t x, uint64_t mask) noexcept { return _pdep_u64(x, mask); }
+inline uint32_t pext(uint32_t x, uint32_t mask) noexcept { return _pext_u32(x, mask); }
+inline uint64_t pext(uint64_t x, uint64_t mask) noexcept { return _pext_u64(x, mask); }
+
+template <unsigned D, typename T = uint32_t>
 struct Implementation {
+    static_assert(std::is_same<T, uint32_t>::value || std::is_same<T, uint64_t>::value, "Cell ids have to be uint32_t or uint64_t");
+
     static constexpr unsigned kDimensions = D;
+    static constexpr unsigned kMaxLevels = 8 * sizeof(T) / D; ///< number of bits per coordinate that can be encoded
 
-    static uint32_t deposit(const std::array<uint32_t, D>& coords) noexcept {
-        uint32_t result = 0;
+    static T deposit(const std::array<T, D>& coords) noexcept {
+        T result = 0;
 
-        constexpr auto mask = BitPattern<D, uint32_t>::kEveryDthBit;
+        constexpr auto mask = BitPattern<D, T>::kEveryDthBit;
         for(unsigned i=0; i < D; ++i) {
-            result |= _pdep_u32(coords[i], mask << i);
+            result |= pdep(coords[i], mask << i);
         }
 
         return result;
     }
 
-    static std::array<uint32_t, kDimensions> extract(uint32_t cell) noexcept {
-        std::array<uint32_t, D> result;
+    static std::array<T, kDimensions> extract(T cell) noexcept {
+        std::array<T, D> result;
 
         for(int i = 0; i < D; ++i)
-            result[i] = _pext_u32(cell, BitPattern<D, uint32_t>::kEveryDthBit << i);
+            result[i] = pext(cell, BitPattern<D, T>::kEveryDthBit << i);
 
         return result;
     }
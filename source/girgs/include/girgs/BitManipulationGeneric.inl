@@ -2,6 +2,8 @@
 #include <array>
 #include <cassert>
 #include <cstdint>
+#include <string>
+#include <type_traits>
 
 #ifdef USE_BMI2
 #include <immintrin.h>
@@ -200,9 +202,12 @@ struct Deposit<4> {
     }
 };
 
-template <unsigned D>
+template <unsigned D, typename T = uint32_t>
 struct Implementation {
+    static_assert(std::is_same<T, uint32_t>::value, "Cell ids have to be uint32_t or uint64_t");
+
     static constexpr unsigned kDimensions = D;
+    static constexpr unsigned kMaxLevels = 32 / D; ///< number of bits per coordinate that can be encoded
 
     static uint32_t deposit(const std::array<uint32_t, D>& coords) {
         return Deposit<D>::deposit(coords);
@@ -217,6 +222,45 @@ struct Implementation {
     }
 };
 
+// 64 bit cell ids are composed of two 32 bit codes: the lower one holds the first kMaxLevels/2 bits
+// of each coordinate and the upper one the next kMaxLevels/2 bits
+template <unsigned D>
+struct Implementation<D, uint64_t> {
+    static constexpr unsigned kDimensions = D;
+    static constexpr unsigned kMaxLevels = 2 * (32 / D); ///< number of bits per coordinate that can be encoded
+
+    static uint64_t deposit(const std::array<uint64_t, D>& coords) {
+        std::array<uint32_t, D> lower, upper;
+        for(auto d = 0u; d < D; ++d) {
+            lower[d] = static_cast<uint32_t>(coords[d] & kHalfCoordMask);
+            upper[d] = static_cast<uint32_t>(coords[d] >> kHalfLevels);
+        }
+
+        return Deposit<D>::deposit(lower) | (static_cast<uint64_t>(Deposit<D>::deposit(upper)) << kHalfBits);
+    }
+
+    static std::array<uint64_t, kDimensions> extract(uint64_t cell) {
+        const auto lower = Extract<D>::extract(static_cast<uint32_t>(cell & kHalfCellMask));
+        const auto upper = Extract<D>::extract(static_cast<uint32_t>(cell >> kHalfBits));
+
+        std::array<uint64_t, D> result;
+        for(auto d = 0u; d < D; ++d)
+            result[d] = lower[d] | (static_cast<uint64_t>(upper[d]) << kHalfLevels);
+
+        return result;
+    }
+
+    static std::string name() {
+        return "Generic";
+    }
+
+private:
+    static constexpr unsigned kHalfLevels = 32 / D;
+    static constexpr unsigned kHalfBits = D * kHalfLevels;
+    static constexpr uint64_t kHalfCoordMask = (uint64_t{1} << kHalfLevels) - 1;
+    static constexpr uint64_t kHalfCellMask  = (uint64_t{1} << kHalfBits) - 1;
+};
+
 } // namespace Generic
 } // namespace BitManipulationDetails
 } // namespace girgs
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+#include <omp.h>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  A graph in compressed sparse row (CSR) format.
+ *  The neighbors of node u are neighbors[offsets[u]], ..., neighbors[offsets[u+1]-1] in ascending order.
+ *
+ * @tparam NodeId
+ *  Type of the node indices (int or int64_t).
+ */
+template <typename NodeId>
+struct CSRGraph {
+    std::vector<uint64_t> offsets;  ///< n+1 entries, offsets[0] = 0 and offsets[n] = neighbors.size()
+    std::vector<NodeId> neighbors;
+};
+
+/**
+ * @brief
+ *  Builds a CSRGraph from the edges of two sampling runs that produce the same edges, e.g. two calls of
+ *  generateEdges(..., EdgeCallback&) with the same non-negative seed.
+ *  The first run only counts the degrees, the second one writes the neighbors to their final position.
+ *  So besides the result only n counters are needed, in contrast to materializing, sorting and converting an edge list.
+ *
+ *  count() and add() may be called concurrently from an edge callback.
+ *
+ * @tparam NodeId
+ *  Type of the node indices (int or int64_t).
+ */
+template <typename NodeId>
+class CSRBuilder {
+public:
+    /**
+     * @param n
+     *  Number of nodes.
+     * @param symmetric
+     *  If true, each edge {u,v} appears in the neighbors of u and v.
+     *  Otherwise only in the neighbors of min(u,v), i.e. the result is the upper triangle of the adjacency matrix.
+     */
+    CSRBuilder(size_t n, bool symmetric)
+        : m_symmetric(symmetric)
+        , m_counters(n)
+    { }
+
+    /// first pass: counts the edge {u,v}
+    void count(NodeId u, NodeId v) {
+        if (m_symmetric) {
+            m_counters[u].fetch_add(1, std::memory_order_relaxed);
+            m_counters[v].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_counters[std::min(u, v)].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// between the passes: computes the offsets and allocates the neighbors
+    void allocate() {
+        const auto n = m_counters.size();
+        m_graph.offsets.resize(n + 1);
+
+        // exclusive prefix sum; the counters become the next free position of each node
+        uint64_t sum = 0;
+        for (size_t u = 0; u < n; ++u) {
+            m_graph.offsets[u] = sum;
+            sum += m_counters[u].load(std::memory_order_relaxed);
+            m_counters[u].store(m_graph.offsets[u], std::memory_order_relaxed);
+        }
+        m_graph.offsets[n] = sum;
+
+        m_graph.neighbors.resize(sum);
+    }
+
+    /// second pass: adds the edge {u,v}
+    void add(NodeId u, NodeId v) {
+        if (m_symmetric) {
+            put(u, v);
+            put(v, u);
+        } else {
+            put(std::min(u, v), std::max(u, v));
+        }
+    }
+
+    /// after the second pass: sorts the neighbors and returns the graph; the builder must not be used afterwards
+    CSRGraph<NodeId> finish() {
+        const auto n = static_cast<long long>(m_counters.size());
+        std::vector<std::atomic<uint64_t>>().swap(m_counters);
+
+        // the order within each list depends on the thread schedule of the second pass
+        auto& offsets = m_graph.offsets;
+        auto& neighbors = m_graph.neighbors;
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (long long u = 0; u < n; ++u)
+            std::sort(neighbors.begin() + offsets[u], neighbors.begin() + offsets[u + 1]);
+
+        return std::move(m_graph);
+    }
+
+private:
+    void put(NodeId u, NodeId v) {
+        const auto pos = m_counters[u].fetch_add(1, std::memory_order_relaxed);
+        assert(pos < m_graph.offsets[u + 1]); // both passes have to produce the same edges
+        m_graph.neighbors[pos] = v;
+    }
+
+    const bool m_symmetric;
+    std::vector<std::atomic<uint64_t>> m_counters;
+    CSRGraph<NodeId> m_graph;
+};
+
+} // namespace girgs
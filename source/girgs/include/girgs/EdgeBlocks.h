@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+#include <omp.h>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  Edge callback that collects all edges without any synchronization.
+ *  Each thread appends to its own chain of fixed-size blocks; no block is ever reallocated.
+ *  It can be passed wherever an EdgeCallback is expected (e.g. generateEdges(..., EdgeCallback&) or SpatialTree).
+ *
+ *  After the generation, merge() concatenates the blocks into one edge list: a prefix sum over the block sizes
+ *  yields the offset of each block, so all blocks are copied in parallel into a vector that is allocated once.
+ *  Alternatively, segments() exposes the blocks without copying.
+ *
+ * @tparam NodeId
+ *  Type of the node indices (int or int64_t).
+ */
+template <typename NodeId = int>
+class EdgeBlocks {
+public:
+    using edge_type = std::pair<NodeId, NodeId>;
+    using block_type = std::vector<edge_type>;
+
+    static constexpr size_t default_block_size = size_t{1} << 20;
+
+    explicit EdgeBlocks(size_t block_size = default_block_size, int max_threads = omp_get_max_threads())
+        : m_block_size(block_size)
+        , m_local_blocks(max_threads)
+    {
+        assert(block_size > 0);
+    }
+
+    void operator()(NodeId u, NodeId v, int tid) {
+        assert(0 <= tid && tid < m_local_blocks.size());
+        auto& blocks = m_local_blocks[tid].first;
+        if (blocks.empty() || blocks.back().size() == m_block_size) {
+            blocks.emplace_back();
+            blocks.back().reserve(m_block_size);
+        }
+        blocks.back().emplace_back(u, v);
+    }
+
+    /// number of collected edges
+    size_t size() const {
+        size_t result = 0;
+        for (auto& local : m_local_blocks)
+            for (auto& block : local.first)
+                result += block.size();
+        return result;
+    }
+
+    /// the collected edges as ranges [begin, end), ordered by thread id; valid until merge() is called
+    std::vector<std::pair<const edge_type*, const edge_type*>> segments() const {
+        std::vector<std::pair<const edge_type*, const edge_type*>> result;
+        for (auto& local : m_local_blocks)
+            for (auto& block : local.first)
+                result.emplace_back(block.data(), block.data() + block.size());
+        return result;
+    }
+
+    /// moves all edges into one edge list (ordered as segments()) and releases the blocks
+    std::vector<edge_type> merge() {
+        std::vector<block_type*> blocks;
+        std::vector<size_t> offsets(1, 0);
+        for (auto& local : m_local_blocks) {
+            for (auto& block : local.first) {
+                blocks.push_back(&block);
+                offsets.push_back(offsets.back() + block.size());
+            }
+        }
+
+        std::vector<edge_type> result(offsets.back());
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (long long i = 0; i < static_cast<long long>(blocks.size()); ++i) {
+            std::copy(blocks[i]->cbegin(), blocks[i]->cend(), result.begin() + offsets[i]);
+            block_type().swap(*blocks[i]); // release memory as early as possible
+        }
+
+        for (auto& local : m_local_blocks)
+            local.first.clear();
+
+        return result;
+    }
+
+private:
+    const size_t m_block_size;
+
+    std::vector<std::pair<
+            std::vector<block_type>,
+            uint64_t[31] /* avoid false sharing */
+    > > m_local_blocks;
+};
+
+} // namespace girgs
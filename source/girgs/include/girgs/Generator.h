@@ -2,8 +2,10 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 
 #include <girgs/girgs_api.h>
+#include <girgs/CSRGraph.h>
 
 
 namespace girgs {
@@ -19,11 +21,12 @@ namespace girgs {
  *  The power law exponent to sample the new weights. Should be 2.0 to h3.0.
  * @param weightSeed
  *  A seed for weight sampling. Should not be equal to the position seed.
+ *  The sampled weights only depend on the seed and not on the number of threads.
  *
  * @return
  *  The weights according to the desired distribution.
  */
-GIRGS_API std::vector<double> generateWeights(int n, double ple, int weightSeed, bool parallel = true);
+GIRGS_API std::vector<double> generateWeights(long long n, double ple, int weightSeed, bool parallel = true);
 
 /**
  * @brief
@@ -35,11 +38,26 @@ GIRGS_API std::vector<double> generateWeights(int n, double ple, int weightSeed,
  *  Dimension of the geometry.
  * @param positionSeed
  *  Seed to sample the positions.
+ *  The sampled positions only depend on the seed and not on the number of threads.
  *
  * @return
  *  The positions on a torus. All inner vectors have the same length.
  */
-GIRGS_API std::vector<std::vector<double>> generatePositions(int n, int dimension, int positionSeed, bool parallel = true);
+GIRGS_API std::vector<std::vector<double>> generatePositions(long long n, int dimension, int positionSeed, bool parallel = true);
+
+/**
+ * @brief
+ *  Same as generatePositions(long long, int, int, bool) but writes the coordinates into a caller owned buffer
+ *  (e.g. mmap'd memory) instead of allocating one vector per node. The sampled coordinates are the same.
+ *
+ * @param positions
+ *  Output: the coordinates of node i are written to positions[i*stride], ..., positions[i*stride + dimension-1].
+ *  Other entries are not touched.
+ * @param stride
+ *  Distance (in doubles) between the first coordinates of consecutive nodes; at least dimension.
+ *  Use dimension for a dense row-major buffer of n*dimension doubles.
+ */
+GIRGS_API void generatePositions(long long n, int dimension, int positionSeed, double* positions, size_t stride, bool parallel = true);
 
 /**
  * @brief
@@ -80,13 +98,141 @@ GIRGS_API double scaleWeights(std::vector<double>& weights, double desiredAvgDeg
  *  Edge probability parameter.
  * @param samplingSeed
  *  Seed to sample the edges.
+ *  The sampled edges only depend on the seed and not on the number of threads.
+ *  The order of the edge list may differ between runs with multiple threads.
  *
  * @return
  *  An edge list with zero based indices.
+ *
+ * @throw std::length_error
+ *  If there are 2^31-1 or more nodes. Use generateEdges64() instead.
  */
 GIRGS_API std::vector<std::pair<int,int>> generateEdges(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
         double alpha, int samplingSeed);
 
+/**
+ * @brief
+ *  Same as generateEdges(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int)
+ *  but with 64 bit node indices, i.e. for graphs with more than 2^31-1 nodes.
+ *  The edges are the same as for 32 bit indices; each edge takes twice the memory though.
+ */
+GIRGS_API std::vector<std::pair<int64_t,int64_t>> generateEdges64(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+        double alpha, int samplingSeed);
+
+/**
+ * @brief
+ *  Same as generateEdges(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int)
+ *  but reads the positions from a caller owned buffer (see generatePositions(long long, int, int, double*, size_t, bool)).
+ *
+ * @param positions
+ *  The coordinates of node i are positions[i*stride], ..., positions[i*stride + dimension-1].
+ * @param dimension
+ *  Dimension of the torus.
+ * @param stride
+ *  Distance (in doubles) between the first coordinates of consecutive nodes.
+ */
+GIRGS_API std::vector<std::pair<int,int>> generateEdges(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed);
+
+/// Same as generateEdges(const std::vector<double>&, const double*, int, size_t, double, int) but with 64 bit node indices.
+GIRGS_API std::vector<std::pair<int64_t,int64_t>> generateEdges64(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed);
+
+/**
+ * @brief
+ *  Samples edges according to weights and positions like generateEdges(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int)
+ *  but hands every edge to a user supplied callback instead of collecting them in an edge list.
+ *  Use this to stream edges into a file or a consumer without materializing the graph.
+ *  See BatchedEdgeCallback for an adapter that hands out per-thread batches of edges.
+ *
+ * @tparam NodeId
+ *  Signed integer type of the node indices passed to the callback; int or int64_t.
+ *  Pass int64_t explicitly for graphs with 2^31-1 or more nodes, e.g. generateEdges<int64_t>(...).
+ *  Otherwise std::length_error is thrown.
+ * @param weights
+ *  Power law distributed weights.
+ * @param positions
+ *  Positions on a torus. All inner vectors should have the same length indicating the dimension of the torus.
+ * @param alpha
+ *  Edge probability parameter.
+ * @param samplingSeed
+ *  Seed to sample the edges.
+ * @param edgeCallback
+ *  Called as edgeCallback(u, v, tid) for each edge {u,v} with zero based indices.
+ *  tid is the OpenMP thread number of the caller in [0, omp_get_max_threads()).
+ *  Calls with different tids may happen concurrently, calls with the same tid never do.
+ */
+template <typename NodeId = int, typename EdgeCallback>
+void generateEdges(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+        double alpha, int samplingSeed, EdgeCallback& edgeCallback);
+
+/// Same as generateEdges(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int, EdgeCallback&)
+/// but reads the positions from a caller owned buffer (see generateEdges(const std::vector<double>&, const double*, int, size_t, double, int)).
+template <typename NodeId = int, typename EdgeCallback>
+void generateEdges(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed, EdgeCallback& edgeCallback);
+
+/**
+ * @brief
+ *  Samples uniform positions and edges in one go, like generatePositions() followed by
+ *  generateEdges(const std::vector<double>&, const double*, int, size_t, double, int, EdgeCallback&).
+ *  The positions are generated directly in the order of the cells of the SpatialTree, i.e. the library
+ *  neither classifies nor sorts them (see SpatialTree::samplePartition()).
+ *  They follow the same distribution as the ones of generatePositions(), but differ for the same seed.
+ *
+ * @param weights
+ *  Power law distributed weights.
+ * @param dimension
+ *  Dimension of the torus.
+ * @param positionSeed
+ *  Seed to sample the positions.
+ *  The sampled positions only depend on the seed and not on the number of threads.
+ * @param alpha
+ *  Edge probability parameter.
+ * @param samplingSeed
+ *  Seed to sample the edges.
+ * @param edgeCallback
+ *  Called as edgeCallback(u, v, tid) for each edge {u,v}, see generateEdges(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int, EdgeCallback&).
+ * @param positions
+ *  Optional output: the coordinates of node i are written to positions[i*stride], ..., positions[i*stride + dimension-1]
+ *  before the edges are sampled.
+ * @param stride
+ *  Distance (in doubles) between the first coordinates of consecutive nodes; 0 means dimension.
+ */
+template <typename NodeId = int, typename EdgeCallback>
+void generatePositionsAndEdges(const std::vector<double>& weights, int dimension, int positionSeed,
+        double alpha, int samplingSeed, EdgeCallback& edgeCallback, double* positions = nullptr, size_t stride = 0);
+
+/**
+ * @brief
+ *  Samples the same graph as generateEdges(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int)
+ *  but returns it in compressed sparse row format without materializing an edge list.
+ *  The edges are sampled twice, first to count the degrees and then to fill the neighbors (see CSRBuilder).
+ *  This roughly doubles the sampling time but the peak memory is only the result and n counters.
+ *
+ * @param symmetric
+ *  If true, each edge {u,v} appears in the neighbors of u and v.
+ *  Otherwise only in the neighbors of min(u,v) (upper triangle).
+ *
+ * @throw std::length_error
+ *  If there are 2^31-1 or more nodes. Use generateCSR64() instead.
+ */
+GIRGS_API CSRGraph<int> generateCSR(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+        double alpha, int samplingSeed, bool symmetric = true);
+
+/// Same as generateCSR(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int, bool) but with 64 bit node indices.
+GIRGS_API CSRGraph<int64_t> generateCSR64(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+        double alpha, int samplingSeed, bool symmetric = true);
+
+/// Same as generateCSR(const std::vector<double>&, const std::vector<std::vector<double>>&, double, int, bool)
+/// with the positions in a caller owned buffer (see generateEdges(const std::vector<double>&, const double*, int, size_t, double, int)).
+GIRGS_API CSRGraph<int> generateCSR(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed, bool symmetric = true);
+
+/// Same as generateCSR(const std::vector<double>&, const double*, int, size_t, double, int, bool) but with 64 bit node indices.
+GIRGS_API CSRGraph<int64_t> generateCSR64(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed, bool symmetric = true);
+
 
 /**
  * @brief
@@ -105,6 +251,21 @@ GIRGS_API std::vector<std::pair<int,int>> generateEdges(const std::vector<double
 GIRGS_API void saveDot(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
         const std::vector<std::pair<int,int>> &graph, const std::string &file);
 
+/// Same as saveDot(const std::vector<double>&, const std::vector<std::vector<double>>&, const std::vector<std::pair<int,int>>&, const std::string&) for 64 bit node indices.
+GIRGS_API void saveDot(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+        const std::vector<std::pair<int64_t,int64_t>> &graph, const std::string &file);
+
+/// Same as saveDot(const std::vector<double>&, const std::vector<std::vector<double>>&, const std::vector<std::pair<int,int>>&, const std::string&)
+/// with the positions in a caller owned buffer (see generateEdges(const std::vector<double>&, const double*, int, size_t, double, int)).
+GIRGS_API void saveDot(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        const std::vector<std::pair<int,int>> &graph, const std::string &file);
+
+/// Same as saveDot(const std::vector<double>&, const double*, int, size_t, const std::vector<std::pair<int,int>>&, const std::string&) for 64 bit node indices.
+GIRGS_API void saveDot(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        const std::vector<std::pair<int64_t,int64_t>> &graph, const std::string &file);
+
 
 
 } // namespace girgs
+
+#include <girgs/Generator.inl>
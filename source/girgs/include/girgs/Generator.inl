@@ -0,0 +1,97 @@
+#include <iostream>
+
+#include <girgs/SpatialTree.h>
+
+
+namespace girgs {
+
+namespace detail {
+
+/// samples the edges of a tree once
+struct SampleOnce {
+    int samplingSeed;
+
+    template <typename Tree>
+    void operator()(Tree& tree) const { tree.generateEdges(samplingSeed); }
+};
+
+/// builds the tree and passes it to sample(tree); uses 32 bit cell ids unless the tree is too deep for them;
+/// positions are either a vector of coordinate vectors or a pointer with a stride (see SpatialTree)
+template <unsigned int D, typename NodeId, typename EdgeCallback, typename Sample, typename... Positions>
+void generateEdgesInDimension(const std::vector<double>& weights, double alpha, const Sample& sample, EdgeCallback& edgeCallback,
+        const Positions&... positions) {
+    if (spatialTreeLevels<D>(weights) <= SpatialTreeCoordinateHelper<D, uint32_t>::maxLevels()) {
+        auto tree = makeSpatialTree<D, SplitMix64, uint32_t, NodeId>(weights, positions..., alpha, edgeCallback);
+        sample(tree);
+    } else {
+        auto tree = makeSpatialTree<D, SplitMix64, uint64_t, NodeId>(weights, positions..., alpha, edgeCallback);
+        sample(tree);
+    }
+}
+
+template <typename NodeId, typename EdgeCallback, typename Sample, typename... Positions>
+void generateEdgesForDimension(size_t dimension, const std::vector<double>& weights, double alpha, const Sample& sample, EdgeCallback& edgeCallback,
+        const Positions&... positions) {
+    switch(dimension) {
+        case 1: generateEdgesInDimension<1, NodeId>(weights, alpha, sample, edgeCallback, positions...); break;
+        case 2: generateEdgesInDimension<2, NodeId>(weights, alpha, sample, edgeCallback, positions...); break;
+        case 3: generateEdgesInDimension<3, NodeId>(weights, alpha, sample, edgeCallback, positions...); break;
+        case 4: generateEdgesInDimension<4, NodeId>(weights, alpha, sample, edgeCallback, positions...); break;
+        case 5: generateEdgesInDimension<5, NodeId>(weights, alpha, sample, edgeCallback, positions...); break;
+        default:
+            std::cout << "Dimension " << dimension << " not supported." << std::endl;
+            std::cout << "No edges generated." << std::endl;
+            break;
+    }
+}
+
+/// same as generateEdgesInDimension() but the tree samples the positions itself
+template <unsigned int D, typename NodeId, typename EdgeCallback>
+void generatePositionsAndEdgesInDimension(const std::vector<double>& weights, int positionSeed, double alpha, int samplingSeed,
+        EdgeCallback& edgeCallback, double* positions, size_t stride) {
+    if (spatialTreeLevels<D>(weights) <= SpatialTreeCoordinateHelper<D, uint32_t>::maxLevels()) {
+        auto tree = makeSpatialTree<D, SplitMix64, uint32_t, NodeId>(weights, positionSeed, alpha, edgeCallback);
+        if (positions)
+            tree.writePositions(positions, stride);
+        tree.generateEdges(samplingSeed);
+    } else {
+        auto tree = makeSpatialTree<D, SplitMix64, uint64_t, NodeId>(weights, positionSeed, alpha, edgeCallback);
+        if (positions)
+            tree.writePositions(positions, stride);
+        tree.generateEdges(samplingSeed);
+    }
+}
+
+} // namespace detail
+
+template <typename NodeId, typename EdgeCallback>
+void generateEdges(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+        double alpha, int samplingSeed, EdgeCallback& edgeCallback) {
+    detail::generateEdgesForDimension<NodeId>(positions.front().size(), weights, alpha, detail::SampleOnce{samplingSeed}, edgeCallback, positions);
+}
+
+template <typename NodeId, typename EdgeCallback>
+void generateEdges(const std::vector<double>& weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed, EdgeCallback& edgeCallback) {
+    detail::generateEdgesForDimension<NodeId>(dimension, weights, alpha, detail::SampleOnce{samplingSeed}, edgeCallback, positions, stride);
+}
+
+template <typename NodeId, typename EdgeCallback>
+void generatePositionsAndEdges(const std::vector<double>& weights, int dimension, int positionSeed,
+        double alpha, int samplingSeed, EdgeCallback& edgeCallback, double* positions, size_t stride) {
+    if (stride == 0)
+        stride = dimension;
+    switch(dimension) {
+        case 1: detail::generatePositionsAndEdgesInDimension<1, NodeId>(weights, positionSeed, alpha, samplingSeed, edgeCallback, positions, stride); break;
+        case 2: detail::generatePositionsAndEdgesInDimension<2, NodeId>(weights, positionSeed, alpha, samplingSeed, edgeCallback, positions, stride); break;
+        case 3: detail::generatePositionsAndEdgesInDimension<3, NodeId>(weights, positionSeed, alpha, samplingSeed, edgeCallback, positions, stride); break;
+        case 4: detail::generatePositionsAndEdgesInDimension<4, NodeId>(weights, positionSeed, alpha, samplingSeed, edgeCallback, positions, stride); break;
+        case 5: detail::generatePositionsAndEdgesInDimension<5, NodeId>(weights, positionSeed, alpha, samplingSeed, edgeCallback, positions, stride); break;
+        default:
+            std::cout << "Dimension " << dimension << " not supported." << std::endl;
+            std::cout << "No edges generated." << std::endl;
+            break;
+    }
+}
+
+} // namespace girgs
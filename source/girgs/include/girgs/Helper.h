@@ -36,4 +36,17 @@ constexpr T pow_to_the(const T x) {
     return detail::pow_helper<D, T>::pow(x);
 }
 
+/// computes x to the power of k where k is only known at run-time (square and multiply)
+template <typename T>
+T pow_int(T x, unsigned int k) {
+    T result{1.0};
+    while (k) {
+        if (k & 1u)
+            result *= x;
+        x *= x;
+        k >>= 1;
+    }
+    return result;
+}
+
 }
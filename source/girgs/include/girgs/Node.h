@@ -5,24 +5,31 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <cstdint>
 
 
 namespace girgs {
 
-template<unsigned int D>
+template<unsigned int D, typename CellId = uint32_t, typename NodeId = int>
 struct Node {
     std::array<double, D>   coord;
     double                  weight;
-    int                     index;
-    int                     cell_id;
+    NodeId                  index;
+    CellId                  cell_id;
 
     Node() {}; // prevent default values
 
-    Node(const std::vector<double>& _coord, double weight, int index, int cell_id = 0)
-        : weight(weight), index(index), cell_id(cell_id)
+    Node(const std::vector<double>& _coord, double weight, NodeId index, CellId cell_id = 0)
+        : Node(_coord.data(), weight, index, cell_id)
     {
         assert(_coord.size()==D);
-        std::copy_n(_coord.cbegin(), D, coord.begin());
+    }
+
+    /// copies the D coordinates starting at _coord
+    Node(const double* _coord, double weight, NodeId index, CellId cell_id = 0)
+        : weight(weight), index(index), cell_id(cell_id)
+    {
+        std::copy_n(_coord, D, coord.begin());
     }
 
     double distance(const Node& other) const {
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cassert>
+
+#include <girgs/Node.h>
+#include <girgs/Helper.h>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  Structure-of-arrays copy of the coordinates and weights of a sorted node array.
+ *  It backs the batched distance kernel used for type 1 checks in SpatialTree:
+ *  one node (A) is compared to #batch_size consecutive nodes (B) at once.
+ *  The loops are written s.t. the compiler emits packed SIMD instructions
+ *  (e.g. 4 doubles per instruction with OPTION_USE_AVX2).
+ *
+ * @tparam D
+ *  the dimension of the geometry
+ */
+template<unsigned int D>
+class NodeColumns {
+public:
+    /// number of B nodes processed per call of batchTerms
+    static constexpr unsigned int batch_size = 8;
+
+    NodeColumns() = default;
+
+    /// copies coordinates and weights; the columns are padded s.t. a batch may start at any node
+    template <typename CellId, typename NodeId>
+    explicit NodeColumns(const std::vector<Node<D, CellId, NodeId>>& nodes) {
+        const auto n = static_cast<long long>(nodes.size());
+        for (auto& column : m_coords)
+            column.assign(n + batch_size, 0.0);
+        m_weights.assign(n + batch_size, 0.0);
+
+        #pragma omp parallel for schedule(static)
+        for (long long k = 0; k < n; ++k) {
+            for (auto d = 0u; d < D; ++d)
+                m_coords[d][k] = nodes[k].coord[d];
+            m_weights[k] = nodes[k].weight;
+        }
+    }
+
+    /**
+     * @brief
+     *  Computes the terms of the edge probability between node A and the nodes first, ..., first+batch_size-1.
+     *  This uses the same floating point operations in the same order as Node::distance(),
+     *  i.e. the results are identical to a pairwise evaluation.
+     *
+     * @param coordA
+     *  The coordinates of A.
+     * @param weightA
+     *  The weight of A.
+     * @param W
+     *  The sum of all weights.
+     * @param first
+     *  Position of the first B node in the sorted node array.
+     * @param d_terms
+     *  Output: \f$ ||x_A - x_B||^D \f$ for each B.
+     * @param w_terms
+     *  Output: \f$ w_A w_B / W \f$ for each B.
+     */
+    void batchTerms(const std::array<double, D>& coordA, double weightA, double W, size_t first,
+                    double* d_terms, double* w_terms) const noexcept {
+        assert(first + batch_size <= m_weights.size());
+
+        double distances[batch_size] = {};
+        for (auto d = 0u; d < D; ++d) {
+            const auto* coordB = m_coords[d].data() + first;
+            const auto a = coordA[d];
+            #pragma omp simd
+            for (auto k = 0u; k < batch_size; ++k) {
+                auto dist = std::abs(a - coordB[k]);
+                dist = dist < 1.0 - dist ? dist : 1.0 - dist;
+                distances[k] = distances[k] < dist ? dist : distances[k];
+            }
+        }
+
+        const auto* weightB = m_weights.data() + first;
+        #pragma omp simd
+        for (auto k = 0u; k < batch_size; ++k) {
+            d_terms[k] = pow_to_the<D>(distances[k]);
+            w_terms[k] = weightA * weightB[k] / W;
+        }
+    }
+
+private:
+    std::array<std::vector<double>, D> m_coords; ///< m_coords[d][k] is the d-th coordinate of the k-th node
+    std::vector<double> m_weights;               ///< m_weights[k] is the weight of the k-th node
+};
+
+} // namespace girgs
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  Bijective 64 bit mixing function (finalizer of SplitMix64).
+ *  Consecutive inputs are mapped to statistically independent looking outputs.
+ */
+inline uint64_t mix64(uint64_t x) noexcept {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief
+ *  Combines a key with another value, e.g. to derive the key of a random stream
+ *  from a seed and the identity of a task: streamKey(streamKey(seed, cellA), cellB).
+ */
+inline uint64_t streamKey(uint64_t key, uint64_t value) noexcept {
+    return mix64(key ^ mix64(value + 0x9e3779b97f4a7c15ull));
+}
+
+/**
+ * @brief
+ *  Counter-based random engine (SplitMix64).
+ *  The i-th output is a hash of key + i * gamma, so constructing an engine is
+ *  as cheap as storing its key. This allows us to give every sampling task its own
+ *  random stream that only depends on the seed and the task, but not on the thread executing it.
+ *
+ *  Satisfies the UniformRandomBitGenerator requirements and can be used with the std distributions.
+ */
+class SplitMix64 {
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t key = 0) noexcept
+        : m_state(key)
+    {}
+
+    void seed(uint64_t key) noexcept {
+        m_state = key;
+    }
+
+    result_type operator()() noexcept {
+        m_state += 0x9e3779b97f4a7c15ull;
+        return mix64(m_state);
+    }
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+private:
+    uint64_t m_state;
+};
+
+/**
+ * @brief
+ *  xoshiro256++ by Blackman and Vigna: a small and very fast engine with 256 bit state.
+ *  The state is expanded from a 64 bit key with SplitMix64, so engines for different
+ *  keys are cheap to construct and statistically independent.
+ *
+ *  Satisfies the UniformRandomBitGenerator requirements and can be used with the std distributions.
+ */
+class Xoshiro256PlusPlus {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256PlusPlus(uint64_t key = 0) noexcept {
+        seed(key);
+    }
+
+    void seed(uint64_t key) noexcept {
+        SplitMix64 expand(key);
+        for (auto& word : m_state)
+            word = expand();
+    }
+
+    result_type operator()() noexcept {
+        const auto result = rotl(m_state[0] + m_state[3], 23) + m_state[0];
+        const auto t = m_state[1] << 17;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+
+        return result;
+    }
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t m_state[4];
+};
+
+/**
+ * @brief
+ *  Philox4x32-10 by Salmon et al.: a counter-based engine whose i-th output block is a
+ *  keyed bijection of the counter i. Similar to SplitMix64 it has no setup cost beyond
+ *  storing the key, but it passes all BigCrush tests with a large safety margin.
+ *  Each block of four 32 bit words yields two 64 bit outputs.
+ *
+ *  Satisfies the UniformRandomBitGenerator requirements and can be used with the std distributions.
+ */
+class Philox4x32 {
+public:
+    using result_type = uint64_t;
+
+    explicit Philox4x32(uint64_t key = 0) noexcept {
+        seed(key);
+    }
+
+    void seed(uint64_t key) noexcept {
+        m_key[0] = static_cast<uint32_t>(key);
+        m_key[1] = static_cast<uint32_t>(key >> 32);
+        m_counter = 0;
+        m_next = 2; // no buffered outputs
+    }
+
+    result_type operator()() noexcept {
+        if (m_next == 2) {
+            generateBlock();
+            m_next = 0;
+        }
+        return m_block[m_next++];
+    }
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+private:
+    void generateBlock() noexcept {
+        uint32_t ctr[4] = {static_cast<uint32_t>(m_counter), static_cast<uint32_t>(m_counter >> 32), 0, 0};
+        uint32_t key[2] = {m_key[0], m_key[1]};
+        ++m_counter;
+
+        for (int round = 0; round < 10; ++round) {
+            const auto prod0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+            const auto prod1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+            const uint32_t next[4] = {
+                static_cast<uint32_t>(prod1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(prod1),
+                static_cast<uint32_t>(prod0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(prod0)};
+            std::copy(next, next + 4, ctr);
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+
+        m_block[0] = (static_cast<uint64_t>(ctr[1]) << 32) | ctr[0];
+        m_block[1] = (static_cast<uint64_t>(ctr[3]) << 32) | ctr[2];
+    }
+
+    uint32_t m_key[2];
+    uint64_t m_counter;
+    uint64_t m_block[2];
+    unsigned int m_next;
+};
+
+/// uniform double in [0, 1) built from the upper 53 bits of a single 64 bit output
+template <typename Engine>
+inline double uniformUnit(Engine& gen) {
+    static_assert(Engine::min() == 0 && Engine::max() == std::numeric_limits<uint64_t>::max(), "Engine has to produce 64 random bits");
+    return static_cast<double>(gen() >> 11) * (1.0 / 9007199254740992.0); // 2^-53
+}
+
+/**
+ * @brief
+ *  Uniform real distribution on [a, b) that consumes exactly one output of a 64 bit engine.
+ *  Unlike std::uniform_real_distribution it never has to reject or loop.
+ */
+class FastUniformRealDistribution {
+public:
+    explicit FastUniformRealDistribution(double a = 0.0, double b = 1.0) noexcept
+        : m_a(a), m_scale(b - a)
+    {}
+
+    template <typename Engine>
+    double operator()(Engine& gen) const {
+        return m_a + m_scale * uniformUnit(gen);
+    }
+
+private:
+    double m_a;
+    double m_scale;
+};
+
+/**
+ * @brief
+ *  Geometric distribution (number of failures before the first success with probability p)
+ *  by inversion: floor(log(U) / log(1-p)). The denominator is precomputed, so each sample
+ *  costs one output of a 64 bit engine and a single log.
+ */
+class FastGeometricDistribution {
+public:
+    explicit FastGeometricDistribution(double p) noexcept
+        : m_inv_log_q(1.0 / std::log1p(-p))
+    {
+        assert(0.0 < p && p <= 1.0);
+    }
+
+    template <typename Engine>
+    unsigned long long operator()(Engine& gen) const {
+        // U in (0, 1] to avoid log(0)
+        const auto u = static_cast<double>((gen() >> 11) + 1) * (1.0 / 9007199254740992.0);
+        const auto skip = std::floor(std::log(u) * m_inv_log_q);
+        return skip < 9e18 ? static_cast<unsigned long long>(skip) : std::numeric_limits<unsigned long long>::max() / 2;
+    }
+
+private:
+    double m_inv_log_q; ///< 1 / log(1-p)
+};
+
+} // namespace girgs
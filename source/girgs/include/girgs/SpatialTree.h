@@ -5,19 +5,42 @@
 #include <algorithm>
 #include <random>
 #include <limits>
+#include <cmath>
 #include <numeric>
 #include <cassert>
+#include <stdexcept>
 
 #include <omp.h>
 
 #include <girgs/SpatialTreeCoordinateHelper.h>
 #include <girgs/WeightLayer.h>
+#include <girgs/NodeColumns.h>
+#include <girgs/Random.h>
 
 
 namespace girgs {
 
 using default_random_engine = std::mt19937_64;
 
+/**
+ * @brief
+ *  The number of levels of a SpatialTree for the given weights, i.e. the partitioning base level
+ *  of the two lightest weight layers plus one. It grows as \f$ \log_2(W/w_0^2) / D \f$.
+ *  Use it to decide whether 32 bit cell ids suffice (see SpatialTreeCoordinateHelper::maxLevels()).
+ *
+ * @tparam D
+ *  Dimension of the underlying geometry.
+ * @param weights
+ *  The weights of all nodes.
+ */
+template<unsigned int D>
+unsigned int spatialTreeLevels(const std::vector<double>& weights) {
+    const auto w0 = *std::min_element(weights.begin(), weights.end());
+    const auto W = std::accumulate(weights.begin(), weights.end(), 0.0);
+    const auto baseLevelConstant = static_cast<int>(std::log2(W/w0/w0));
+    return static_cast<unsigned int>(std::max((baseLevelConstant - 2) / static_cast<int>(D), 0)) + 1;
+}
+
 /**
  * @brief
  *  Internal implementation of the linear time GIRG sampling algorithm following the method object pattern.
@@ -25,15 +48,88 @@ using default_random_engine = std::mt19937_64;
  *
  * @tparam D
  *  Dimension of the underlying geometry.
+ * @tparam EdgeCallback
+ *  Called as edgeCallback(u, v, threadId) for each sampled edge.
+ * @tparam Engine
+ *  Random engine with 64 bit outputs that can be constructed from a 64 bit key, e.g.
+ *  SplitMix64, Xoshiro256PlusPlus or Philox4x32 (see Random.h) or std::mt19937_64.
+ *  One engine is constructed for each call of sampleTypeI() and sampleTypeII(),
+ *  so cheap construction matters.
+ * @tparam CellId
+ *  Type of cell ids (uint32_t or uint64_t). The tree must not have more than
+ *  SpatialTreeCoordinateHelper<D, CellId>::maxLevels() levels (see spatialTreeLevels()).
+ *  64 bit ids allow for deeper trees, i.e. larger n in high dimensions, but make each node 8 bytes larger.
+ * @tparam NodeId
+ *  Signed integer type of node indices (int or int64_t) as passed to the EdgeCallback.
+ *  It also stores the prefix sums into the node array, i.e. it limits the number of nodes.
+ *  Use int64_t for graphs with more than 2^31-1 nodes.
  */
-template<unsigned int D, typename EdgeCallback>
+template<unsigned int D, typename EdgeCallback, typename Engine = SplitMix64, typename CellId = uint32_t, typename NodeId = int>
 class SpatialTree
 {
-    using CoordinateHelper = SpatialTreeCoordinateHelper<D>;
+    using CoordinateHelper = SpatialTreeCoordinateHelper<D, CellId>;
+    using NodeType = Node<D, CellId, NodeId>;
+    using WeightLayerType = WeightLayer<D, CellId, NodeId>;
 
 public:
+    /**
+     * @brief
+     *  Builds the data structure for the given weights and positions.
+     *
+     * @param weights
+     *  The weights of all nodes.
+     * @param positions
+     *  The positions of all nodes; each inner vector has D coordinates in [0,1).
+     * @param alpha
+     *  Edge probability parameter.
+     * @param edgeCallback
+     *  Called as edgeCallback(u, v, threadId) for each sampled edge.
+     * @param profile
+     *  Whether to print the time spent in the phases of the algorithm.
+     */
     SpatialTree(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions, double alpha, EdgeCallback& edgeCallback, bool profile = false);
 
+    /**
+     * @brief
+     *  Same as SpatialTree(const std::vector<double>&, const std::vector<std::vector<double>>&, double, EdgeCallback&, bool)
+     *  but reads the positions from a caller owned buffer (e.g. mmap'd), which is not copied beyond the nodes of the tree.
+     *  The coordinates of node i are positions[i*stride], ..., positions[i*stride + D-1].
+     *  The buffer is only accessed during construction.
+     *
+     * @param positions
+     *  Pointer to the first coordinate of node 0.
+     * @param stride
+     *  Distance (in doubles) between the first coordinates of consecutive nodes; D for a dense row-major buffer.
+     */
+    SpatialTree(const std::vector<double>& weights, const double* positions, size_t stride, double alpha, EdgeCallback& edgeCallback, bool profile = false);
+
+    /**
+     * @brief
+     *  Samples uniform positions on the torus together with the data structure (see samplePartition()).
+     *  Instead of classifying and sorting given positions, each node draws a random cell of its layer
+     *  (a coarse bucket first, then a cell within it), the nodes are counting sorted by these cells,
+     *  and the points are generated directly in cell order, i.e. unsorted positions are never materialized.
+     *  The positions follow the same distribution as generatePositions(), but they are not the same for a given seed.
+     *  Use writePositions() to obtain them.
+     *
+     * @param positionSeed
+     *  Seed to sample the positions. They only depend on the seed and not on the number of threads.
+     *  A negative seed draws a random one.
+     */
+    SpatialTree(const std::vector<double>& weights, int positionSeed, double alpha, EdgeCallback& edgeCallback, bool profile = false);
+
+    /**
+     * @brief
+     *  Writes the coordinates of all nodes in a caller owned buffer, e.g. the positions sampled by
+     *  SpatialTree(const std::vector<double>&, int, double, EdgeCallback&, bool).
+     *
+     * @param positions
+     *  Output: the coordinates of node i are written to positions[i*stride], ..., positions[i*stride + D-1].
+     * @param stride
+     *  Distance (in doubles) between the first coordinates of consecutive nodes; at least D.
+     */
+    void writePositions(double* positions, size_t stride) const;
+
     /**
      * @brief
      *  Samples edges for given positions and weights.
@@ -47,8 +143,10 @@ public:
      *  Zero produces a clique.
      * @param seed
      *  The seed for the edge sampling.
-     *  If OpenMP is given more than one thread, thread i uses seed+i.
-     *  This means that results are only reproducible for a combination of seed and thread number.
+     *  Each pair of cells and weight layers uses its own random stream derived from the seed (see taskGenerator()).
+     *  Hence, the sampled edges only depend on the seed and not on the number of threads.
+     *  Only the order in which the edges are reported may differ between runs.
+     *  A negative seed draws a random one.
      */
     void generateEdges(int seed);
 
@@ -67,13 +165,15 @@ protected:
      * @param level
      *  The level from which A and B are, meaning cellA and cellB must be in the same level.
      */
-    void visitCellPair(unsigned int cellA, unsigned int cellB, unsigned int level);
+    void visitCellPair(CellId cellA, CellId cellB, unsigned int level);
 
     /**
      * @brief
      *  Same as visitCellPair(unsigned int, unsigned int, unsigned int) but stops recursion before first_parallel_level.
      *  Instead, the calls that would be made in this level are saved in parallel_calls.
      *  The saved calls are grouped by their (level local) cellA parameter.
+     *  The type 1 and type 2 samples of the levels above are handed to sampleInTask(), s.t. expensive ones
+     *  run in parallel while the recursion continues. Must be called from within a parallel region.
      *
      * @param cellA
      *  Same as in visitCellPair(unsigned int, unsigned int, unsigned int).
@@ -88,8 +188,61 @@ protected:
      *  We get \f$ l \geq \log_2(kt) / d \f$.
      * @param parallel_calls
      */
-    void visitCellPair_sequentialStart(unsigned int cellA, unsigned int cellB, unsigned int level,
-            unsigned int first_parallel_level, std::vector<std::vector<unsigned int>>& parallel_calls);
+    void visitCellPair_sequentialStart(CellId cellA, CellId cellB, unsigned int level,
+            unsigned int first_parallel_level, std::vector<std::vector<CellId>>& parallel_calls);
+
+    /**
+     * @brief
+     *  Calls sampleTypeI() or sampleTypeII() in a new OpenMP task if \f$ |V_i^A| \cdot |V_j^B| \f$ is large enough
+     *  to outweigh the overhead of a task. Otherwise the sample is taken immediately.
+     *
+     * @param typeI
+     *  Whether to call sampleTypeI() or sampleTypeII().
+     * @param cellA
+     *  Same as in sampleTypeI().
+     * @param cellB
+     *  Same as in sampleTypeI().
+     * @param level
+     *  Same as in sampleTypeI().
+     * @param i
+     *  Same as in sampleTypeI().
+     * @param j
+     *  Same as in sampleTypeI().
+     */
+    void sampleInTask(bool typeI, CellId cellA, CellId cellB, unsigned int level, unsigned int i, unsigned int j);
+
+    /**
+     * @brief
+     *  Same as visitCellPair(unsigned int, unsigned int, unsigned int) but spawns an OpenMP task for each child pair
+     *  as long as the subtree is expensive (see numPointsInCell()). Cheap subtrees are processed by visitCellPair()
+     *  in the current task. Idle threads pick up the spawned tasks, which balances skewed inputs at run time.
+     *  Must be called from within a parallel region.
+     *
+     * @param cellA
+     *  Same as in visitCellPair(unsigned int, unsigned int, unsigned int).
+     * @param cellB
+     *  Same as in visitCellPair(unsigned int, unsigned int, unsigned int).
+     * @param level
+     *  Same as in visitCellPair(unsigned int, unsigned int, unsigned int).
+     * @param task_cutoff
+     *  Subtrees of cell pairs with at most this many points in total are not split any further.
+     */
+    void visitCellPair_parallel(CellId cellA, CellId cellB, unsigned int level, long long task_cutoff);
+
+    /**
+     * @brief
+     *  The number of points in a cell that are relevant for the recursion below this cell,
+     *  i.e. \f$ \sum_i |V_i^{cell}| \f$ over all weight layers i inserted in this level or deeper.
+     *  Used as a cost estimate for visitCellPair_parallel().
+     *
+     * @param cell
+     *  The cell that contains the points.
+     * @param level
+     *  The level of the given cell.
+     * @return
+     *  The number of points.
+     */
+    long long numPointsInCell(CellId cell, unsigned int level) const;
 
     /**
      * @brief
@@ -107,7 +260,11 @@ protected:
      * @param j
      *  The weight layer for all considered nodes in cellB.
      */
-    void sampleTypeI(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j);
+    void sampleTypeI(CellId cellA, CellId cellB, unsigned int level, unsigned int i, unsigned int j);
+
+    /// Implementation of sampleTypeI(); IntAlpha is alpha if it is a small integer and 0 otherwise (see connected()).
+    template<unsigned int IntAlpha>
+    void sampleTypeIImpl(CellId cellA, CellId cellB, unsigned int level, unsigned int i, unsigned int j);
 
     /**
      * @brief
@@ -125,7 +282,53 @@ protected:
      * @param j
      *  The weight layer for all considered nodes in cellB.
      */
-    void sampleTypeII(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j);
+    void sampleTypeII(CellId cellA, CellId cellB, unsigned int level, unsigned int i, unsigned int j);
+
+    /// Implementation of sampleTypeII(); IntAlpha is alpha if it is a small integer and 0 otherwise (see connected()).
+    template<unsigned int IntAlpha>
+    void sampleTypeIIImpl(CellId cellA, CellId cellB, unsigned int level, unsigned int i, unsigned int j);
+
+    /**
+     * @brief
+     *  Decides if a pair with the given terms is an edge in the binomial model, i.e. whether
+     *  \f$ rnd < (w\_term / d\_term)^\alpha \f$.
+     *  With \f$ x = w\_term / d\_term < 1 \f$ we have \f$ x^{\lfloor\alpha\rfloor+1} \le x^\alpha \le x^{\lfloor\alpha\rfloor} \f$.
+     *  Both bounds only need multiplications and decide almost all pairs;
+     *  std::pow is evaluated only if rnd falls between them. Hence the decisions are the same as with std::pow.
+     *
+     * @tparam IntAlpha
+     *  If alpha is a small integer, it is passed at compile time and the power is unrolled with pow_to_the().
+     *  Use 0 otherwise.
+     * @param w_term
+     *  \f$ w_u w_v / W \f$
+     * @param d_term
+     *  \f$ ||x_u - x_v||^d \f$
+     * @param rnd
+     *  A uniform random number in \f$ [0, 1) \f$ (or a subinterval).
+     * @return
+     *  True iff the pair is connected.
+     */
+    template<unsigned int IntAlpha>
+    bool connected(double w_term, double d_term, double rnd) const;
+
+    /**
+     * @brief
+     *  The random engine used to sample node pairs in \f$ V_i^A \times V_j^B \f$.
+     *  Its stream is derived from the seed and the arguments only, i.e. it does not depend on the thread executing the task.
+     *  Since each call of sampleTypeI() or sampleTypeII() has a unique set of arguments, tasks get independent streams.
+     *
+     * @param cellA
+     *  Same as in sampleTypeI().
+     * @param cellB
+     *  Same as in sampleTypeI().
+     * @param i
+     *  Same as in sampleTypeI().
+     * @param j
+     *  Same as in sampleTypeI().
+     * @return
+     *  A freshly keyed engine.
+     */
+    Engine taskGenerator(CellId cellA, CellId cellB, unsigned int i, unsigned int j) const;
 
     /**
      * @brief
@@ -179,8 +382,50 @@ protected:
     unsigned int partitioningBaseLevel(int layer1, int layer2) const;
 
 
-    std::vector<WeightLayer<D>> buildPartition(
-        const std::vector<double>& weights, const std::vector<std::vector<double>>& positions);
+    /**
+     * @brief
+     *  Sorts the nodes into their cells and builds the weight layers.
+     *
+     * @param weights
+     *  The weights of all nodes.
+     * @param coordinates
+     *  Called as coordinates(i) and returns a pointer to the D coordinates of node i.
+     */
+    template<typename Coordinates>
+    std::vector<WeightLayerType> buildPartition(
+        const std::vector<double>& weights, Coordinates coordinates);
+
+    /**
+     * @brief
+     *  Samples uniform positions and builds the weight layers without classifying and sorting points, i.e. it yields
+     *  the same data structure as buildPartition() for positions drawn i.i.d. uniformly at random.
+     *  Instead of a point, each node draws a uniform cell of its layer's target level in two steps:
+     *  A single counting sort pass moves the index and weight of each node into a random coarse cell (bucket).
+     *  Within a bucket (which fits into the cache) each node draws a random descendant cell and is sorted by it.
+     *  Finally, the positions are drawn within the cells, so the nodes are created in sorted order.
+     *
+     * @param weights
+     *  The weights of all nodes.
+     * @param positionSeed
+     *  Each layer and cell uses its own random stream derived from this seed.
+     */
+    std::vector<WeightLayerType> samplePartition(
+        const std::vector<double>& weights, uint64_t positionSeed);
+
+
+private:
+    /// initializes the parameters of the tree; the data structure is built by preprocess()
+    SpatialTree(const std::vector<double>& weights, double alpha, EdgeCallback& edgeCallback, bool profile);
+
+    /// determines the layer pairs and builds the data structure; partition() returns the weight layers, e.g. buildPartition()
+    template<typename Partition>
+    void preprocess(Partition partition);
+
+    /// the id of the first cell of each weight layer's target level in the cell id space of m_first_in_cell; one extra entry for the end
+    std::vector<CellId> firstCellOfLayer() const;
+
+    /// builds the node columns and the weight layers once m_nodes and m_first_in_cell are complete
+    std::vector<WeightLayerType> buildWeightLayers(const std::vector<CellId>& first_cell_of_layer);
 
 
 private:
@@ -188,6 +433,8 @@ private:
     const bool m_profile;
 
     double m_alpha;             ///< girg model parameter, with higher alpha, long edges become less likely
+    unsigned int m_alpha_floor; ///< floor(alpha) if alpha is finite and not too large, 0 otherwise, which disables the lower bound in connected()
+    unsigned int m_integral_alpha; ///< alpha if it is such an integer, 0 otherwise
     long long m_n;              ///< number of nodes in the graph
 
     double m_w0;                ///< minimum weight
@@ -198,13 +445,14 @@ private:
     unsigned int m_layers; ///< number of layers
     unsigned int m_levels; ///< number of levels
     
-    std::vector<Node<D>>        m_nodes;            ///< nodes ordered by layer first and morton code second
-    std::vector<unsigned int>   m_first_in_cell;    ///< prefix sums into nodes array
-    std::vector<WeightLayer<D>> m_weight_layers;    ///< provides access to the nodes as described in paper
+    std::vector<NodeType>       m_nodes;            ///< nodes ordered by layer first and morton code second
+    std::vector<NodeId>         m_first_in_cell;    ///< prefix sums into nodes array; indexed by cell id
+    NodeColumns<D>              m_node_columns;     ///< SoA copy of coordinates and weights of m_nodes for type 1 checks
+    std::vector<WeightLayerType> m_weight_layers;   ///< provides access to the nodes as described in paper
     std::vector<std::vector<std::pair<unsigned int, unsigned int>>> m_layer_pairs; ///< which pairs of weight layers to check in each level
 
 
-    std::vector<default_random_engine> m_gens; ///< random generators for each thread
+    uint64_t m_seed; ///< seed of the current edge sampling; see taskGenerator()
 
 #ifndef NDEBUG
     long long m_type1_checks = 0; ///< number of node pairs that are checked via a type 1 check
@@ -213,13 +461,28 @@ private:
 };
 
 
-/// provide automatic type deduction for constructor
-template <unsigned int D, typename EdgeCallback>
-SpatialTree<D,EdgeCallback> makeSpatialTree(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
+/// provide automatic type deduction for constructor; the engine, cell id and node id types may be chosen explicitly,
+/// e.g. makeSpatialTree<2, Xoshiro256PlusPlus, uint64_t, int64_t>(...)
+template <unsigned int D, typename Engine = SplitMix64, typename CellId = uint32_t, typename NodeId = int, typename EdgeCallback>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId> makeSpatialTree(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions,
         double alpha, EdgeCallback& edgeCallback, bool profile = false) {
     return {weights, positions, alpha, edgeCallback, profile};
 }
 
+/// provide automatic type deduction for constructor with positions in a caller owned buffer
+template <unsigned int D, typename Engine = SplitMix64, typename CellId = uint32_t, typename NodeId = int, typename EdgeCallback>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId> makeSpatialTree(const std::vector<double>& weights, const double* positions, size_t stride,
+        double alpha, EdgeCallback& edgeCallback, bool profile = false) {
+    return {weights, positions, stride, alpha, edgeCallback, profile};
+}
+
+/// provide automatic type deduction for constructor that samples the positions itself
+template <unsigned int D, typename Engine = SplitMix64, typename CellId = uint32_t, typename NodeId = int, typename EdgeCallback>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId> makeSpatialTree(const std::vector<double>& weights, int positionSeed,
+        double alpha, EdgeCallback& edgeCallback, bool profile = false) {
+    return {weights, positionSeed, alpha, edgeCallback, profile};
+}
+
 
 } // namespace girgs
 
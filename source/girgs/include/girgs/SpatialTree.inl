@@ -6,11 +6,47 @@
 namespace girgs {
 
 
-template<unsigned int D, typename EdgeCallback>
-SpatialTree<D, EdgeCallback>::SpatialTree(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions, double alpha, EdgeCallback& edgeCallback, bool profile)
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::SpatialTree(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions, double alpha, EdgeCallback& edgeCallback, bool profile)
+: SpatialTree(weights, alpha, edgeCallback, profile)
+{
+    assert(weights.size() == positions.size());
+    assert(positions.size() > 0 && positions.front().size() == D);
+    preprocess([&] () -> std::vector<WeightLayerType> {
+        return buildPartition(weights, [&positions] (size_t i) { return positions[i].data(); });
+    });
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::SpatialTree(const std::vector<double>& weights, const double* positions, size_t stride, double alpha, EdgeCallback& edgeCallback, bool profile)
+: SpatialTree(weights, alpha, edgeCallback, profile)
+{
+    assert(positions != nullptr && stride >= D);
+    preprocess([&] () -> std::vector<WeightLayerType> {
+        return buildPartition(weights, [positions, stride] (size_t i) { return positions + i * stride; });
+    });
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::SpatialTree(const std::vector<double>& weights, int positionSeed, double alpha, EdgeCallback& edgeCallback, bool profile)
+: SpatialTree(weights, alpha, edgeCallback, profile)
+{
+    const auto seed = positionSeed >= 0 ? static_cast<uint64_t>(positionSeed) : std::random_device()();
+    preprocess([&] () -> std::vector<WeightLayerType> {
+        return samplePartition(weights, seed);
+    });
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::SpatialTree(const std::vector<double>& weights, double alpha, EdgeCallback& edgeCallback, bool profile)
 : m_EdgeCallback(edgeCallback)
 , m_profile(profile)
 , m_alpha(alpha)
+, m_alpha_floor(alpha < 1024.0 ? static_cast<unsigned int>(alpha) : 0u)
+, m_integral_alpha(alpha == m_alpha_floor ? m_alpha_floor : 0u)
 , m_n(weights.size())
 , m_w0(*std::min_element(weights.begin(), weights.end()))
 , m_wn(*std::max_element(weights.begin(), weights.end()))
@@ -19,10 +55,19 @@ SpatialTree<D, EdgeCallback>::SpatialTree(const std::vector<double>& weights, co
 , m_layers(static_cast<unsigned int>(floor(std::log2(m_wn/m_w0)))+1)
 , m_levels(partitioningBaseLevel(0,0) + 1) // (log2(W/w0^2) - 2) / d
 {
-    assert(weights.size() == positions.size());
-    assert(positions.size() > 0 && positions.front().size() == D);
+    assert(m_levels == spatialTreeLevels<D>(weights));
+
+    if (m_levels > CoordinateHelper::maxLevels())
+        throw std::length_error("SpatialTree: too many levels for the cell id type; use 64 bit cell ids");
+    if (weights.size() >= static_cast<size_t>(std::numeric_limits<NodeId>::max()))
+        throw std::length_error("SpatialTree: too many nodes for the node id type; use 64 bit node ids");
+}
 
-    ScopedTimer timer("Preprocessing", profile);
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+template<typename Partition>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::preprocess(Partition partition) {
+    ScopedTimer timer("Preprocessing", m_profile);
 
     // determine which layer pairs to sample in which level
     m_layer_pairs.resize(m_levels);
@@ -32,21 +77,30 @@ SpatialTree<D, EdgeCallback>::SpatialTree(const std::vector<double>& weights, co
 
     // sort weights into exponentially growing layers
     {
-        ScopedTimer timer("Build DS", profile);
-        m_weight_layers = buildPartition(weights, positions);
+        ScopedTimer timer("Build DS", m_profile);
+        m_weight_layers = partition();
     }
 }
 
 
-template<unsigned int D, typename EdgeCallback>
-void SpatialTree<D, EdgeCallback>::generateEdges(int seed) {
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::writePositions(double* positions, size_t stride) const {
+    assert(positions != nullptr && stride >= D);
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < m_n; ++i) {
+        const auto& node = m_nodes[i];
+        std::copy_n(node.coord.begin(), D, positions + static_cast<size_t>(node.index) * stride);
+    }
+}
+
 
-    // one random generator and distribution for each thread
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::generateEdges(int seed) {
+
+    // all random streams are derived from this seed; see taskGenerator
+    m_seed = seed >= 0 ? static_cast<uint64_t>(seed) : std::random_device()();
     const auto num_threads = omp_get_max_threads();
-    m_gens.resize(num_threads);
-    for (int thread = 0; thread < num_threads; thread++) {
-        m_gens[thread].seed(seed >= 0 ? seed+thread : std::random_device()());
-    } 
 
 #ifndef NDEBUG
     // ensure that all node pairs are compared either type 1 or type 2
@@ -64,27 +118,51 @@ void SpatialTree<D, EdgeCallback>::generateEdges(int seed) {
 
     // parallel see docs for visitCellPair_sequentialStart
     const auto first_parallel_level = static_cast<unsigned int>(std::ceil(std::log2(4.0*num_threads) / D));
-    const auto parallel_cells = SpatialTreeCoordinateHelper<D>::numCellsInLevel(first_parallel_level);
-    const auto first_parallel_cell = SpatialTreeCoordinateHelper<D>::firstCellOfLevel(first_parallel_level);
-
-    // saw off recursion before "first_parallel_level" and save all calls that would be made
-    auto parallel_calls = std::vector<std::vector<unsigned int>>(parallel_cells);
-    visitCellPair_sequentialStart(0, 0, 0, first_parallel_level, parallel_calls);
-
-    // do the collected calls in parallel
-    #pragma omp parallel for schedule(static), num_threads(num_threads) // dynamic scheduling would be better but not reproducible
-    for (int i = 0; i < parallel_cells; ++i) {
-        auto current_cell = first_parallel_cell + i;
-        for (auto each : parallel_calls[i])
-            visitCellPair(current_cell, each, first_parallel_level);
+    const auto parallel_cells = CoordinateHelper::numCellsInLevel(first_parallel_level);
+    const auto first_parallel_cell = CoordinateHelper::firstCellOfLevel(first_parallel_level);
+
+    // subtrees with fewer points are not worth a task of their own
+    constexpr auto tasks_per_thread = 16;
+    constexpr auto min_task_cutoff = 1024ll;
+    const auto task_cutoff = std::max(min_task_cutoff, 2 * m_n / (tasks_per_thread * num_threads));
+
+    // the random streams do not depend on the executing thread, so we are free to balance the load dynamically
+    #pragma omp parallel num_threads(num_threads)
+    #pragma omp single
+    {
+        // saw off recursion before "first_parallel_level" and save all calls that would be made;
+        // expensive samples in the top levels are already started as tasks while we're traversing
+        auto parallel_calls = std::vector<std::vector<CellId>>(parallel_cells);
+        visitCellPair_sequentialStart(0, 0, 0, first_parallel_level, parallel_calls);
+
+        // order the collected calls by their estimated cost, s.t. expensive subtrees are started first
+        using Task = std::pair<long long, std::pair<CellId, CellId>>;
+        auto tasks = std::vector<Task>();
+        for (CellId i = 0; i < parallel_cells; ++i) {
+            auto current_cell = first_parallel_cell + i;
+            auto points_in_current = numPointsInCell(current_cell, first_parallel_level);
+            for (auto each : parallel_calls[i])
+                tasks.push_back({points_in_current + numPointsInCell(each, first_parallel_level), {current_cell, each}});
+        }
+        std::sort(tasks.begin(), tasks.end(), [] (const Task& a, const Task& b) {
+            return a.first > b.first; });
+
+        // do the collected calls in parallel;
+        // expensive subtrees are split recursively into tasks that are picked up by idle threads
+        for (const auto& task : tasks) {
+            const auto cellA = task.second.first;
+            const auto cellB = task.second.second;
+            #pragma omp task firstprivate(cellA, cellB)
+            visitCellPair_parallel(cellA, cellB, first_parallel_level, task_cutoff);
+        }
     }
 
     assert(m_type1_checks + m_type2_checks == m_n*(m_n - 1ll));
 }
 
 
-template<unsigned int D, typename EdgeCallback>
-void SpatialTree<D, EdgeCallback>::visitCellPair(unsigned int cellA, unsigned int cellB, unsigned int level) {
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::visitCellPair(CellId cellA, CellId cellB, unsigned int level) {
     if(!CoordinateHelper::touching(cellA, cellB, level)) { // not touching
         // sample all type 2 occurrences with this cell pair
         #ifdef NDEBUG
@@ -115,10 +193,10 @@ void SpatialTree<D, EdgeCallback>::visitCellPair(unsigned int cellA, unsigned in
 
 
 
-template<unsigned int D, typename EdgeCallback>
-void SpatialTree<D, EdgeCallback>::visitCellPair_sequentialStart(unsigned int cellA, unsigned int cellB, unsigned int level,
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::visitCellPair_sequentialStart(CellId cellA, CellId cellB, unsigned int level,
                                                    unsigned int first_parallel_level,
-                                                   std::vector<std::vector<unsigned int>> &parallel_calls) {
+                                                   std::vector<std::vector<CellId>> &parallel_calls) {
     if(!CoordinateHelper::touching(cellA, cellB, level)) { // not touching
         // sample all type 2 occurrences with this cell pair
         #ifdef NDEBUG
@@ -126,14 +204,14 @@ void SpatialTree<D, EdgeCallback>::visitCellPair_sequentialStart(unsigned int ce
         #endif // NDEBUG
         for(auto l=level; l<m_levels; ++l)
             for(auto& layer_pair : m_layer_pairs[l])
-                sampleTypeII(cellA, cellB, level, layer_pair.first, layer_pair.second);
+                sampleInTask(false, cellA, cellB, level, layer_pair.first, layer_pair.second);
         return;
     }
 
     // sample all type 1 occurrences with this cell pair
     for(auto& layer_pair : m_layer_pairs[level]){
         if(cellA != cellB || layer_pair.first <= layer_pair.second)
-            sampleTypeI(cellA, cellB, level, layer_pair.first, layer_pair.second);
+            sampleInTask(true, cellA, cellB, level, layer_pair.first, layer_pair.second);
     }
 
     // break if last level reached
@@ -153,9 +231,83 @@ void SpatialTree<D, EdgeCallback>::visitCellPair_sequentialStart(unsigned int ce
 
 
 
-template<unsigned int D, typename EdgeCallback>
-void SpatialTree<D, EdgeCallback>::sampleTypeI(
-        unsigned int cellA, unsigned int cellB, unsigned int level,
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::sampleInTask(bool typeI, CellId cellA, CellId cellB, unsigned int level,
+        unsigned int i, unsigned int j) {
+    // cost estimate: number of node pairs in V_i^A x V_j^B
+    const auto sizeV_i_A = static_cast<long long>(m_weight_layers[i].pointsInCell(cellA, level));
+    const auto sizeV_j_B = static_cast<long long>(m_weight_layers[j].pointsInCell(cellB, level));
+
+    // cheap samples are not worth the overhead of a task
+    constexpr auto min_pairs_per_task = 1ll << 14;
+    if (sizeV_i_A * sizeV_j_B < min_pairs_per_task) {
+        if (typeI) sampleTypeI(cellA, cellB, level, i, j);
+        else       sampleTypeII(cellA, cellB, level, i, j);
+        return;
+    }
+
+    #pragma omp task firstprivate(typeI, cellA, cellB, level, i, j)
+    {
+        if (typeI) sampleTypeI(cellA, cellB, level, i, j);
+        else       sampleTypeII(cellA, cellB, level, i, j);
+    }
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::visitCellPair_parallel(CellId cellA, CellId cellB, unsigned int level, long long task_cutoff) {
+    // type 2 pairs and cheap subtrees are processed sequentially in the current task
+    if(!CoordinateHelper::touching(cellA, cellB, level) || level == m_levels-1
+       || numPointsInCell(cellA, level) + numPointsInCell(cellB, level) <= task_cutoff) {
+        visitCellPair(cellA, cellB, level);
+        return;
+    }
+
+    // sample all type 1 occurrences with this cell pair
+    for(auto& layer_pair : m_layer_pairs[level]){
+        if(cellA != cellB || layer_pair.first <= layer_pair.second)
+            sampleTypeI(cellA, cellB, level, layer_pair.first, layer_pair.second);
+    }
+
+    // spawn a task for all children pairs (a,b) where a in A and b in B
+    for(auto a = CoordinateHelper::firstChild(cellA); a<=CoordinateHelper::lastChild(cellA); ++a)
+        for(auto b = cellA == cellB ? a : CoordinateHelper::firstChild(cellB); b<=CoordinateHelper::lastChild(cellB); ++b) {
+            #pragma omp task firstprivate(a, b)
+            visitCellPair_parallel(a, b, level+1, task_cutoff);
+        }
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+long long SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::numPointsInCell(CellId cell, unsigned int level) const {
+    auto result = 0ll;
+    for(auto i = 0u; i < m_layers; ++i)
+        if(weightLayerTargetLevel(i) >= level)
+            result += m_weight_layers[i].pointsInCell(cell, level);
+    return result;
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::sampleTypeI(
+        CellId cellA, CellId cellB, unsigned int level,
+        unsigned int i, unsigned int j)
+{
+    switch (m_integral_alpha) {
+        case 2:  sampleTypeIImpl<2>(cellA, cellB, level, i, j); break;
+        case 3:  sampleTypeIImpl<3>(cellA, cellB, level, i, j); break;
+        case 4:  sampleTypeIImpl<4>(cellA, cellB, level, i, j); break;
+        case 5:  sampleTypeIImpl<5>(cellA, cellB, level, i, j); break;
+        case 6:  sampleTypeIImpl<6>(cellA, cellB, level, i, j); break;
+        default: sampleTypeIImpl<0>(cellA, cellB, level, i, j); break;
+    }
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+template<unsigned int IntAlpha>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::sampleTypeIImpl(
+        CellId cellA, CellId cellB, unsigned int level,
         unsigned int i, unsigned int j)
 {
     assert(partitioningBaseLevel(i, j) == level || !CoordinateHelper::touching(cellA, cellB, level)); // in this case we were redirected from typeII with maxProb==1.0
@@ -178,52 +330,82 @@ void SpatialTree<D, EdgeCallback>::sampleTypeI(
     }
 #endif // NDEBUG
 
-    std::uniform_real_distribution<> dist;
+    FastUniformRealDistribution dist;
     const auto threadId = omp_get_thread_num();
+    auto gen = taskGenerator(cellA, cellB, i, j);
 
     const auto inThresholdMode = m_alpha == std::numeric_limits<double>::infinity();
 
-    int kA = 0;
-    for(auto pointerA = rangeA.first; pointerA != rangeA.second; ++kA, ++pointerA) {
-        auto offset = (cellA == cellB && i==j) ? kA+1 : 0;
-        for (auto pointerB = rangeB.first + offset; pointerB != rangeB.second; ++pointerB) {
+    // we compare each node in A with batches of consecutive nodes in B using the SIMD kernel of NodeColumns
+    constexpr auto batch_size = NodeColumns<D>::batch_size;
+    double d_terms[batch_size];
+    double w_terms[batch_size];
 
-            const auto& nodeInA = *pointerA;
-            const auto& nodeInB = *pointerB;
+    const auto endB = rangeB.second - m_nodes.data();
 
-			// pointer magic gives same results
-			assert(nodeInA.index == m_weight_layers[i].kthPoint(cellA, level, kA).index);
-			assert(nodeInB.index == m_weight_layers[j].kthPoint(cellB, level, std::distance(rangeB.first, pointerB)).index);
+    NodeId kA = 0;
+    for(auto pointerA = rangeA.first; pointerA != rangeA.second; ++kA, ++pointerA) {
+        const auto& nodeInA = *pointerA;
+        auto offset = (cellA == cellB && i==j) ? kA+1 : 0;
 
-            // points are in correct cells
-            assert(cellA - CoordinateHelper::firstCellOfLevel(level) == CoordinateHelper::cellForPoint(nodeInA.coord, level));
-            assert(cellB - CoordinateHelper::firstCellOfLevel(level) == CoordinateHelper::cellForPoint(nodeInB.coord, level));
+        // pointer magic gives same results
+        assert(nodeInA.index == m_weight_layers[i].kthPoint(cellA, level, kA).index);
+        // points are in correct cells
+        assert(cellA - CoordinateHelper::firstCellOfLevel(level) == CoordinateHelper::cellForPoint(nodeInA.coord, level));
+        // points are in correct weight layer
+        assert(i == static_cast<unsigned int>(std::log2(nodeInA.weight/m_w0)));
 
-            // points are in correct weight layer
-            assert(i == static_cast<unsigned int>(std::log2(nodeInA.weight/m_w0)));
-            assert(j == static_cast<unsigned int>(std::log2(nodeInB.weight/m_w0)));
+        for (auto firstB = (rangeB.first + offset) - m_nodes.data(); firstB < endB; firstB += batch_size) {
+            m_node_columns.batchTerms(nodeInA.coord, nodeInA.weight, m_W, firstB, d_terms, w_terms);
+            const auto nodesInBatch = static_cast<unsigned int>(std::min<long long>(batch_size, endB - firstB));
 
-            assert(nodeInA.index != nodeInB.index);
-            const auto distance = nodeInA.distance(nodeInB);
-            const auto w_term = nodeInA.weight*nodeInB.weight/m_W;
-            const auto d_term = pow_to_the<D>(distance);
+#ifndef NDEBUG
+            for (auto k = 0u; k < nodesInBatch; ++k) {
+                const auto& nodeInB = m_nodes[firstB + k];
+                assert(nodeInB.index == m_weight_layers[j].kthPoint(cellB, level, firstB + k - (rangeB.first - m_nodes.data())).index);
+                assert(cellB - CoordinateHelper::firstCellOfLevel(level) == CoordinateHelper::cellForPoint(nodeInB.coord, level));
+                assert(j == static_cast<unsigned int>(std::log2(nodeInB.weight/m_w0)));
+                assert(nodeInA.index != nodeInB.index);
+                assert(d_terms[k] == pow_to_the<D>(nodeInA.distance(nodeInB)));
+                assert(w_terms[k] == nodeInA.weight*nodeInB.weight/m_W);
+            }
+#endif // NDEBUG
 
             if(inThresholdMode) {
-                if(d_term < w_term)
-                    m_EdgeCallback(nodeInA.index, nodeInB.index, threadId);
+                for (auto k = 0u; k < nodesInBatch; ++k)
+                    if(d_terms[k] < w_terms[k])
+                        m_EdgeCallback(nodeInA.index, m_nodes[firstB + k].index, threadId);
             } else {
-                auto edge_prob = std::pow(w_term/d_term, m_alpha); // we don't need min with 1.0 here
-                if(dist(m_gens[threadId]) < edge_prob)
-                    m_EdgeCallback(nodeInA.index, nodeInB.index, threadId);
+                for (auto k = 0u; k < nodesInBatch; ++k) {
+                    if(connected<IntAlpha>(w_terms[k], d_terms[k], dist(gen)))
+                        m_EdgeCallback(nodeInA.index, m_nodes[firstB + k].index, threadId);
+                }
             }
         }
     }
 }
 
 
-template<unsigned int D, typename EdgeCallback>
-void SpatialTree<D, EdgeCallback>::sampleTypeII(
-        unsigned int cellA, unsigned int cellB, unsigned int level,
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::sampleTypeII(
+        CellId cellA, CellId cellB, unsigned int level,
+        unsigned int i, unsigned int j)
+{
+    switch (m_integral_alpha) {
+        case 2:  sampleTypeIIImpl<2>(cellA, cellB, level, i, j); break;
+        case 3:  sampleTypeIIImpl<3>(cellA, cellB, level, i, j); break;
+        case 4:  sampleTypeIIImpl<4>(cellA, cellB, level, i, j); break;
+        case 5:  sampleTypeIIImpl<5>(cellA, cellB, level, i, j); break;
+        case 6:  sampleTypeIIImpl<6>(cellA, cellB, level, i, j); break;
+        default: sampleTypeIIImpl<0>(cellA, cellB, level, i, j); break;
+    }
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+template<unsigned int IntAlpha>
+void SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::sampleTypeIIImpl(
+        CellId cellA, CellId cellB, unsigned int level,
         unsigned int i, unsigned int j)
 {
     assert(partitioningBaseLevel(i, j) >= level);
@@ -250,7 +432,7 @@ void SpatialTree<D, EdgeCallback>::sampleTypeII(
     // branch predictions and prefetching. Hence low expected skip distances
     // it's cheapter to throw a coin each time!
     if (max_connection_prob > 0.2) {
-        return sampleTypeI(cellA, cellB, level, i, j);
+        return sampleTypeIImpl<IntAlpha>(cellA, cellB, level, i, j);
     }
 
 #ifndef NDEBUG
@@ -263,14 +445,14 @@ void SpatialTree<D, EdgeCallback>::sampleTypeII(
 
     // init geometric distribution
     auto threadId = omp_get_thread_num();
-    auto& gen = m_gens[threadId];
-    auto geo = std::geometric_distribution<unsigned long long>(max_connection_prob);
-    auto dist = std::uniform_real_distribution<>(0, max_connection_prob);
+    auto gen = taskGenerator(cellA, cellB, i, j);
+    auto geo = FastGeometricDistribution(max_connection_prob);
+    auto dist = FastUniformRealDistribution(0, max_connection_prob);
 
     for (auto r = geo(gen); r < num_pairs; r += 1 + geo(gen)) {
         // determine the r-th pair
-        const Node<D>& nodeInA = rangeA.first[r%sizeV_i_A];
-        const Node<D>& nodeInB = rangeB.first[r/sizeV_i_A];
+        const NodeType& nodeInA = rangeA.first[r%sizeV_i_A];
+        const NodeType& nodeInB = rangeB.first[r/sizeV_i_A];
 
         nodeInB.prefetch();
         nodeInA.prefetch();
@@ -285,19 +467,51 @@ void SpatialTree<D, EdgeCallback>::sampleTypeII(
         const auto distance = nodeInA.distance(nodeInB);
         const auto w_term = nodeInA.weight*nodeInB.weight/m_W;
         const auto d_term = pow_to_the<D>(distance);
-        const auto connection_prob = std::pow(w_term/d_term, m_alpha); // we don't need min with 1.0 here
         assert(w_term < w_upper_bound);
         assert(d_term >= dist_lower_bound);
 
-        if(rnd < connection_prob) {
+        if(connected<IntAlpha>(w_term, d_term, rnd)) {
             m_EdgeCallback(nodeInA.index, nodeInB.index, threadId);
         }
     }
 }
 
 
-template<unsigned int D, typename EdgeCallback>
-unsigned int SpatialTree<D, EdgeCallback>::weightLayerTargetLevel(int layer) const {
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+template<unsigned int IntAlpha>
+bool SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::connected(double w_term, double d_term, double rnd) const {
+    assert(IntAlpha == 0 || IntAlpha == m_integral_alpha);
+
+    const auto x = w_term / d_term;
+    if (!(x < 1.0))
+        return true; // connection probability is 1 (rnd < 1 always holds)
+
+    // for x < 1 we have x^(floor(alpha)+1) <= x^alpha <= x^floor(alpha);
+    // the slack covers rounding errors of the integer powers.
+    // If the floor is clamped to 0 (huge alpha), x^0 is still an upper bound but x^1 is no lower bound.
+    constexpr auto slack = 1e-12;
+
+    const auto upper = IntAlpha ? pow_to_the<IntAlpha>(x) : pow_int(x, m_alpha_floor);
+    if (rnd >= upper * (1.0 + slack))
+        return false;
+
+    const auto lower = m_integral_alpha ? upper : (m_alpha_floor ? upper * x : 0.0);
+    if (rnd < lower * (1.0 - slack))
+        return true;
+
+    return rnd < std::pow(x, m_alpha);
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+Engine SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::taskGenerator(CellId cellA, CellId cellB, unsigned int i, unsigned int j) const {
+    const auto layers = (static_cast<uint64_t>(i) << 32) | j;
+    return Engine{streamKey(streamKey(streamKey(m_seed, cellA), cellB), layers)};
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+unsigned int SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::weightLayerTargetLevel(int layer) const {
     // -1 coz w0 is the upper bound for layer 0 in paper and our layers are shifted by -1
     auto result = std::max((m_baseLevelConstant - layer - 1) / (int)D, 0);
 #ifndef NDEBUG
@@ -315,8 +529,8 @@ unsigned int SpatialTree<D, EdgeCallback>::weightLayerTargetLevel(int layer) con
 }
 
 
-template<unsigned int D, typename EdgeCallback>
-unsigned int SpatialTree<D, EdgeCallback>::partitioningBaseLevel(int layer1, int layer2) const {
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+unsigned int SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::partitioningBaseLevel(int layer1, int layer2) const {
 
     // we do the computation on signed ints but cast back after the max with 0
     // m_baseLevelConstant is just log(W/w0^2)
@@ -335,39 +549,30 @@ unsigned int SpatialTree<D, EdgeCallback>::partitioningBaseLevel(int layer1, int
     return static_cast<unsigned int>(result);
 }
 
-template<unsigned int D, typename EdgeCallback>
-std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const std::vector<double>& weights, const std::vector<std::vector<double>>& positions) {
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+template<typename Coordinates>
+std::vector<WeightLayer<D, CellId, NodeId>> SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::buildPartition(const std::vector<double>& weights, Coordinates coordinates) {
 
-    const auto n = weights.size();
-    assert(positions.size() == n);
+    const auto n = static_cast<NodeId>(weights.size());
 
     auto weight_to_layer = [=] (double weight) {
         return std::log2(weight / m_w0);
     };
 
-    const auto first_cell_of_layer = [&] {
-        std::vector<unsigned int> first_cell_of_layer(m_layers + 1);
-        unsigned int sum = 0;
-        for (auto l = 0; l < m_layers; ++l) {
-            first_cell_of_layer[l] = sum;
-            sum += CoordinateHelper::numCellsInLevel(weightLayerTargetLevel(l));
-        }
-        first_cell_of_layer.back() = sum;
-        return first_cell_of_layer;
-    }();
+    const auto first_cell_of_layer = firstCellOfLayer();
     const auto max_cell_id = first_cell_of_layer.back();
 
-    // Node<D> should incur no init overhead; checked on godbolt
-    m_nodes = std::vector<Node<D>>(n); 
+    // Node<D, CellId, NodeId> should incur no init overhead; checked on godbolt
+    m_nodes = std::vector<NodeType>(n); 
     // compute the cell a point belongs to
     {
         ScopedTimer timer("Classify points & precompute coordinates", m_profile);
 
         #pragma omp parallel for
-        for (int i = 0; i < n; ++i) {
+        for (NodeId i = 0; i < n; ++i) {
             const auto layer = weight_to_layer(weights[i]);
             const auto level = weightLayerTargetLevel(layer);
-            m_nodes[i] = Node<D>(positions[i], weights[i], i);
+            m_nodes[i] = NodeType(coordinates(i), weights[i], i);
             m_nodes[i].cell_id = first_cell_of_layer[layer] + CoordinateHelper::cellForPoint(m_nodes[i].coord, level);
             assert(m_nodes[i].cell_id < max_cell_id);
         }
@@ -377,9 +582,9 @@ std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const s
     {
         ScopedTimer timer("Sort points", m_profile);
 
-        auto compare = [](const Node<D> &a, const Node<D> &b) { return a.cell_id < b.cell_id; };
+        auto compare = [](const NodeType &a, const NodeType &b) { return a.cell_id < b.cell_id; };
 
-        intsort::intsort(m_nodes, [](const Node<D> &p) { return p.cell_id; }, max_cell_id);
+        intsort::intsort(m_nodes, [](const NodeType &p) { return p.cell_id; }, max_cell_id);
         //alternatively: std::sort(m_nodes.begin(), m_nodes.end(), compare);
 
         assert(std::is_sorted(m_nodes.begin(), m_nodes.end(), compare));
@@ -387,8 +592,8 @@ std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const s
 
 
     // compute pointers into points
-    constexpr auto gap_cell_indicator = std::numeric_limits<unsigned int>::max();
-    m_first_in_cell = std::vector<unsigned int>(max_cell_id + 1, gap_cell_indicator);
+    constexpr auto gap_cell_indicator = std::numeric_limits<NodeId>::max();
+    m_first_in_cell = std::vector<NodeId>(static_cast<size_t>(max_cell_id) + 1, gap_cell_indicator);
     {
         ScopedTimer timer("Find first point in cell", m_profile);
 
@@ -399,7 +604,7 @@ std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const s
         // the values of those gaps will remain at gap_cell_indicator.
         m_first_in_cell[m_nodes[0].cell_id] = 0;
         #pragma omp parallel for
-        for (int i = 1; i < n; ++i) {
+        for (NodeId i = 1; i < n; ++i) {
             if (m_nodes[i - 1].cell_id != m_nodes[i].cell_id) {
                 m_first_in_cell[m_nodes[i].cell_id] = i;
             }
@@ -423,7 +628,7 @@ std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const s
             {
                 for (int r = 0; r < threads; r++) {
                     const auto end = std::min(max_cell_id, chunk_size * (r + 1));
-                    int first_non_invalid = end - 1;
+                    auto first_non_invalid = end - 1;
                     while (m_first_in_cell[first_non_invalid] == gap_cell_indicator)
                         first_non_invalid++;
                     m_first_in_cell[end - 1] = m_first_in_cell[first_non_invalid];
@@ -450,7 +655,7 @@ std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const s
             assert(std::is_sorted(m_first_in_cell.begin(), m_first_in_cell.end()));
 
             // check that each point is in its right cell (and that the cell boundaries are correct)
-            for (auto cid = 0u; cid != max_cell_id; ++cid) {
+            for (CellId cid = 0; cid != max_cell_id; ++cid) {
                 const auto begin = m_first_in_cell[cid];
                 const auto end = m_first_in_cell[cid + 1];
                 for (auto idx = begin; idx != end; ++idx)
@@ -460,8 +665,206 @@ std::vector<WeightLayer<D>> SpatialTree<D, EdgeCallback>::buildPartition(const s
         #endif
     }
 
+    return buildWeightLayers(first_cell_of_layer);
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+std::vector<WeightLayer<D, CellId, NodeId>> SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::samplePartition(const std::vector<double>& weights, uint64_t positionSeed) {
+
+    const auto n = static_cast<NodeId>(weights.size());
+
+    auto weight_to_layer = [=] (double weight) {
+        return static_cast<unsigned int>(std::log2(weight / m_w0));
+    };
+
+    const auto first_cell_of_layer = firstCellOfLayer();
+    const auto max_cell_id = first_cell_of_layer.back();
+
+    // The cells of bucket_level(l) are the buckets of layer l, i.e. at most 2^10 per layer.
+    // This is coarse enough for a single counting sort pass and fine enough that a bucket fits in the cache.
+    constexpr auto bucket_bits = 10u;
+    auto bucket_level = [&] (unsigned int layer) {
+        return std::min(weightLayerTargetLevel(layer), bucket_bits / D);
+    };
+
+    auto first_bucket_of_layer = std::vector<uint32_t>(m_layers + 1, 0);
+    for (auto l = 0u; l < m_layers; ++l)
+        first_bucket_of_layer[l + 1] = first_bucket_of_layer[l] + static_cast<uint32_t>(CoordinateHelper::numCellsInLevel(bucket_level(l)));
+    const auto num_buckets = first_bucket_of_layer.back();
+
+    // Nodes are assigned to buckets in blocks of this size. Each block has its own random stream (keyed after the
+    // streams of the layers), so the assignment does not depend on the number of threads.
+    constexpr auto block_size = 1ll << 16;
+    const auto blocks = (static_cast<long long>(n) + block_size - 1) / block_size;
+    const auto blocks_key = streamKey(positionSeed, m_layers);
+
+    // distribute the nodes uniformly at random into the buckets of their layer; only index and weight are set
+    auto first_in_bucket = std::vector<NodeId>(static_cast<size_t>(num_buckets) + 1);
+    m_nodes = std::vector<NodeType>(n);
+    {
+        ScopedTimer timer("Distribute nodes into buckets", m_profile);
+
+        const auto max_threads = omp_get_max_threads();
+        auto bucket_of_node = std::vector<uint32_t>(n);
+        auto local_counts = std::vector<std::vector<NodeId>>(max_threads, std::vector<NodeId>(num_buckets, 0));
+
+        #pragma omp parallel num_threads(max_threads)
+        {
+            auto& counts = local_counts[omp_get_thread_num()];
+
+            #pragma omp for schedule(static)
+            for (long long block = 0; block < blocks; ++block) {
+                auto gen = Engine{streamKey(blocks_key, block)};
+                const auto end = std::min<long long>(n, (block + 1) * block_size);
+                for (auto i = block * block_size; i < end; ++i) {
+                    const auto layer = weight_to_layer(weights[i]);
+                    const auto buckets = first_bucket_of_layer[layer + 1] - first_bucket_of_layer[layer]; // a power of two
+                    const auto bucket = first_bucket_of_layer[layer] + static_cast<uint32_t>(gen() & (buckets - 1));
+                    bucket_of_node[i] = bucket;
+                    ++counts[bucket];
+                }
+            }
+
+            // each thread gets its own range in each bucket; with the static schedule
+            // the threads see consecutive blocks, so each bucket is ordered by node index
+            #pragma omp single
+            {
+                NodeId sum = 0;
+                for (uint32_t bucket = 0; bucket < num_buckets; ++bucket) {
+                    first_in_bucket[bucket] = sum;
+                    for (auto& each : local_counts) {
+                        const auto count = each[bucket];
+                        each[bucket] = sum;
+                        sum += count;
+                    }
+                }
+                first_in_bucket[num_buckets] = sum;
+            }
+
+            #pragma omp for schedule(static)
+            for (long long block = 0; block < blocks; ++block) {
+                const auto end = std::min<long long>(n, (block + 1) * block_size);
+                for (auto i = block * block_size; i < end; ++i) {
+                    auto& node = m_nodes[counts[bucket_of_node[i]]++];
+                    node.index = static_cast<NodeId>(i);
+                    node.weight = weights[i];
+                }
+            }
+        }
+
+        assert(first_in_bucket[num_buckets] == n);
+    }
+
+    // Within each bucket, assign the nodes to uniformly random cells of the target level and sort them by cell
+    // (in the cache). Finally, sample the positions within the cells, i.e. directly in sorted order.
+    m_first_in_cell = std::vector<NodeId>(static_cast<size_t>(max_cell_id) + 1);
+    m_first_in_cell[max_cell_id] = n;
+    {
+        ScopedTimer timer("Sample positions & precompute coordinates", m_profile);
+
+        #pragma omp parallel
+        {
+            std::vector<std::pair<NodeId, double>> bucket_nodes; // index and weight in the order of the bucket
+            std::vector<std::pair<NodeId, double>> sorted_nodes; // same, sorted by cell
+            std::vector<CellId> cell_of_node;
+            std::vector<NodeId> cell_begin;
+
+            #pragma omp for schedule(dynamic, 16)
+            for (long long bucket = 0; bucket < static_cast<long long>(num_buckets); ++bucket) {
+                const auto layer = static_cast<unsigned int>(std::upper_bound(first_bucket_of_layer.begin(), first_bucket_of_layer.end(), bucket)
+                                                             - first_bucket_of_layer.begin()) - 1;
+                const auto level = bucket_level(layer);
+                const auto target_level = weightLayerTargetLevel(layer);
+                const auto bucket_cell = static_cast<CellId>(bucket - first_bucket_of_layer[layer]);
+
+                // the descendants of a cell are consecutive in each level below (see SpatialTreeCoordinateHelper::firstChild())
+                const auto child_bits = D * (target_level - level);
+                const auto first_cell = bucket_cell << child_bits;
+                const auto cells = CellId{1} << child_bits;
+
+                const auto begin = first_in_bucket[bucket];
+                const auto end = first_in_bucket[bucket + 1];
+                const auto size = static_cast<size_t>(end - begin);
+
+                // each bucket has its own random stream, disjoint from the ones of other layers and levels
+                auto gen = Engine{streamKey(streamKey(positionSeed, layer), CoordinateHelper::firstCellOfLevel(level) + bucket_cell)};
+
+                // counting sort by cell
+                bucket_nodes.resize(size);
+                cell_of_node.resize(size);
+                cell_begin.assign(static_cast<size_t>(cells) + 1, 0);
+                for (size_t k = 0; k < size; ++k) {
+                    const auto& node = m_nodes[begin + k];
+                    bucket_nodes[k] = {node.index, node.weight};
+                    cell_of_node[k] = child_bits ? static_cast<CellId>(gen() >> (64 - child_bits)) : CellId{0};
+                    ++cell_begin[cell_of_node[k] + 1];
+                }
+                for (CellId cell = 0; cell < cells; ++cell)
+                    cell_begin[cell + 1] += cell_begin[cell];
+
+                const auto prefix_sums = m_first_in_cell.data() + first_cell_of_layer[layer] + first_cell;
+                for (CellId cell = 0; cell < cells; ++cell)
+                    prefix_sums[cell] = begin + cell_begin[cell];
+
+                sorted_nodes.resize(size);
+                for (size_t k = 0; k < size; ++k)
+                    sorted_nodes[cell_begin[cell_of_node[k]]++] = bucket_nodes[k];
+
+                // sample the positions cell by cell; cell_begin now holds the end of each cell
+                auto k = size_t{0};
+                for (CellId cell = 0; cell < cells; ++cell) {
+                    if (k == static_cast<size_t>(cell_begin[cell]))
+                        continue;
+
+                    const auto cell_id = first_cell_of_layer[layer] + first_cell + cell;
+                    const auto bounds = CoordinateHelper::bounds(CoordinateHelper::firstCellOfLevel(target_level) + first_cell + cell, target_level);
+
+                    std::array<double, D> coord;
+                    for (; k < static_cast<size_t>(cell_begin[cell]); ++k) {
+                        for (auto d = 0u; d < D; ++d) {
+                            const auto x = bounds[d].first + (bounds[d].second - bounds[d].first) * uniformUnit(gen);
+                            // rounding must not move the point into the next cell
+                            coord[d] = x < bounds[d].second ? x : std::nextafter(bounds[d].second, 0.0);
+                        }
+
+                        m_nodes[begin + k] = NodeType(coord.data(), sorted_nodes[k].second, sorted_nodes[k].first, cell_id);
+                        assert(CoordinateHelper::cellForPoint(m_nodes[begin + k].coord, target_level) == first_cell + cell);
+                    }
+                }
+                assert(k == size);
+            }
+        }
+    }
+
+    return buildWeightLayers(first_cell_of_layer);
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+std::vector<CellId> SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::firstCellOfLayer() const {
+    std::vector<CellId> first_cell_of_layer(m_layers + 1);
+    CellId sum = 0;
+    for (auto l = 0; l < m_layers; ++l) {
+        first_cell_of_layer[l] = sum;
+        sum += CoordinateHelper::numCellsInLevel(weightLayerTargetLevel(l));
+    }
+    first_cell_of_layer.back() = sum;
+    return first_cell_of_layer;
+}
+
+
+template<unsigned int D, typename EdgeCallback, typename Engine, typename CellId, typename NodeId>
+std::vector<WeightLayer<D, CellId, NodeId>> SpatialTree<D, EdgeCallback, Engine, CellId, NodeId>::buildWeightLayers(const std::vector<CellId>& first_cell_of_layer) {
+
+    // copy coordinates and weights into columns for the SIMD kernel of type 1 checks
+    {
+        ScopedTimer timer("Build node columns", m_profile);
+        m_node_columns = NodeColumns<D>(m_nodes);
+    }
+
     // build spatial structure and find insertion level for each layer based on lower bound on radius for current and smallest layer
-    std::vector<WeightLayer<D>> weight_layers;
+    std::vector<WeightLayerType> weight_layers;
     weight_layers.reserve(m_layers);
     {
         ScopedTimer timer("Build data structure", m_profile);
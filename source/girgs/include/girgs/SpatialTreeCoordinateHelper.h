@@ -1,48 +1,68 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+
+#include <girgs/BitManipulation.h>
 
 namespace girgs {
 
 
-template<unsigned int D>
+/**
+ * @brief
+ *  Static helper to navigate the cells of the spatial tree.
+ *  Cells are numbered level by level; within a level they follow the Morton order (see BitManipulation).
+ *
+ * @tparam D
+ *  the dimension of the geometry
+ * @tparam CellId
+ *  Unsigned type of cell ids. With uint32_t the tree is limited to few levels for large D (see maxLevels()).
+ */
+template<unsigned int D, typename CellId = uint32_t>
 class SpatialTreeCoordinateHelper
 {
 public:
-    static constexpr unsigned int numChildren() noexcept {
-        return 1u<<D;
+    static constexpr CellId numChildren() noexcept {
+        return CellId{1}<<D;
     }
 
-    static constexpr unsigned int numCellsInLevel(unsigned int level) noexcept {
-        return 1u<<(D*level);
+    static constexpr CellId numCellsInLevel(unsigned int level) noexcept {
+        return CellId{1}<<(D*level);
     }
 
-    static constexpr unsigned int firstCellOfLevel(unsigned int level) noexcept {
-        return ((1u<<(D*level))-1)/(numChildren()-1);
+    static constexpr CellId firstCellOfLevel(unsigned int level) noexcept {
+        return ((CellId{1}<<(D*level))-1)/(numChildren()-1);
     }
 
-    static constexpr unsigned int parent(unsigned int cell) noexcept {
+    static constexpr CellId parent(CellId cell) noexcept {
         return (cell-1) / numChildren();
     }
 
-    static constexpr unsigned int firstChild(unsigned int cell) noexcept {
+    static constexpr CellId firstChild(CellId cell) noexcept {
         return numChildren() * cell + 1;
     }
 
-    static constexpr unsigned int lastChild(unsigned int cell) noexcept {
+    static constexpr CellId lastChild(CellId cell) noexcept {
         return firstChild(cell) + numChildren() - 1;
     }
 
+    /// Cells of the levels 0, ..., maxLevels() can be represented with CellId,
+    /// i.e. a tree may have maxLevels() levels plus one level for the lightest weight layer.
+    static constexpr unsigned int maxLevels() noexcept {
+        return ((8 * sizeof(CellId) - 1) / D) < BitManipulation<D, CellId>::kMaxLevels
+             ? ((8 * sizeof(CellId) - 1) / D) : BitManipulation<D, CellId>::kMaxLevels;
+    }
+
 
-    static unsigned int cellOfLevel(unsigned cell) noexcept;
+    static CellId cellOfLevel(CellId cell) noexcept;
 
-    static unsigned int cellForPoint(const std::array<double, D>& position, unsigned int targetLevel) noexcept;
+    static CellId cellForPoint(const std::array<double, D>& position, unsigned int targetLevel) noexcept;
 
-    static std::array<std::pair<double,double>, D> bounds(unsigned int cell, unsigned int level) noexcept;
+    static std::array<std::pair<double,double>, D> bounds(CellId cell, unsigned int level) noexcept;
 
-    static bool touching(unsigned int cellA, unsigned int cellB, unsigned int level) noexcept;
+    static bool touching(CellId cellA, CellId cellB, unsigned int level) noexcept;
 
-    static double dist(unsigned int cellA, unsigned int cellB, unsigned int level) noexcept;
+    static double dist(CellId cellA, CellId cellB, unsigned int level) noexcept;
 
     SpatialTreeCoordinateHelper() = delete; // we want to support static accesses only
 };
@@ -3,27 +3,30 @@
 
 namespace girgs {
 
-template<unsigned int D>
-unsigned int SpatialTreeCoordinateHelper<D>::cellOfLevel(unsigned cell) noexcept {
+template<unsigned int D, typename CellId>
+CellId SpatialTreeCoordinateHelper<D, CellId>::cellOfLevel(CellId cell) noexcept {
     // sets all bits below the most significant bit set in x
-    auto assertLower = [] (uint32_t x) {
+    auto assertLower = [] (CellId x) {
 #if defined(__GNUC__) || defined(__clang__)
         if (__builtin_expect(!x, 0))
-            return 0u; // __builtin_clz(x) is undefined for x == 0
+            return CellId{0}; // __builtin_clz(x) is undefined for x == 0
 
-        return static_cast<uint32_t>(
-            (1llu << (32 - __builtin_clz(x))) - 1);
+        return sizeof(CellId) > 4
+            ? static_cast<CellId>(~0llu >> __builtin_clzll(x))
+            : static_cast<CellId>((1llu << (32 - __builtin_clz(x))) - 1);
 #else
         x |= x >> 1;
         x |= x >> 2;
         x |= x >> 4;
         x |= x >> 8;
         x |= x >> 16;
+        if (sizeof(CellId) > 4)
+            x |= static_cast<CellId>(static_cast<uint64_t>(x) >> 32);
         return x;
 #endif
     };
 
-    constexpr auto mask = BitPattern<D>::kEveryDthBit;
+    constexpr auto mask = BitPattern<D, CellId>::kEveryDthBit;
 
     auto firstCellInLayer = mask & assertLower(cell);
 
@@ -33,10 +36,10 @@ unsigned int SpatialTreeCoordinateHelper<D>::cellOfLevel(unsigned cell) noexcept
     return cell - firstCellInLayer;
 }
 
-template<unsigned int D>
-std::array<std::pair<double, double>, D> SpatialTreeCoordinateHelper<D>::bounds(unsigned int cell, unsigned int level) noexcept {
-    const auto diameter = 1.0 / (1<<level);
-    const auto coord = BitManipulation<D>::extract(cellOfLevel(cell));
+template<unsigned int D, typename CellId>
+std::array<std::pair<double, double>, D> SpatialTreeCoordinateHelper<D, CellId>::bounds(CellId cell, unsigned int level) noexcept {
+    const auto diameter = 1.0 / (CellId{1}<<level);
+    const auto coord = BitManipulation<D, CellId>::extract(cellOfLevel(cell));
 
     auto result = std::array<std::pair<double, double>, D>();
     for(auto d=0u; d<D; ++d)
@@ -45,47 +48,47 @@ std::array<std::pair<double, double>, D> SpatialTreeCoordinateHelper<D>::bounds(
     return result;
 }
 
-template<unsigned int D>
-unsigned int SpatialTreeCoordinateHelper<D>::cellForPoint(const std::array<double, D>& position, unsigned int targetLevel) noexcept {
-    const auto diameter = static_cast<double>(1 << targetLevel);
+template<unsigned int D, typename CellId>
+CellId SpatialTreeCoordinateHelper<D, CellId>::cellForPoint(const std::array<double, D>& position, unsigned int targetLevel) noexcept {
+    const auto diameter = static_cast<double>(CellId{1} << targetLevel);
 
-    std::array<uint32_t, D> coords;
+    std::array<CellId, D> coords;
     for (auto d = 0u; d < D; ++d)
-        coords[d] = static_cast<uint32_t>(position[d] * diameter);
+        coords[d] = static_cast<CellId>(position[d] * diameter);
 
-    return BitManipulation<D>::deposit(coords);
+    return BitManipulation<D, CellId>::deposit(coords);
 }
 
-template<unsigned int D>
-bool SpatialTreeCoordinateHelper<D>::touching(unsigned int cellA, unsigned int cellB, unsigned int level) noexcept  {
-    const auto coordA = BitManipulation<D>::extract(cellOfLevel(cellA));
-    const auto coordB = BitManipulation<D>::extract(cellOfLevel(cellB));
+template<unsigned int D, typename CellId>
+bool SpatialTreeCoordinateHelper<D, CellId>::touching(CellId cellA, CellId cellB, unsigned int level) noexcept  {
+    const auto coordA = BitManipulation<D, CellId>::extract(cellOfLevel(cellA));
+    const auto coordB = BitManipulation<D, CellId>::extract(cellOfLevel(cellB));
 
     auto touching = true;
     for(auto d=0u; d<D; ++d){
-        auto dist = std::abs(static_cast<int>(coordA[d]) - static_cast<int>(coordB[d]));
-        dist = std::min(dist, (1<<level) - dist);
+        auto dist = std::abs(static_cast<long long>(coordA[d]) - static_cast<long long>(coordB[d]));
+        dist = std::min(dist, (1ll<<level) - dist);
         touching &= (dist <= 1);
     }
 
     return touching;
 }
 
-template<unsigned int D>
-double SpatialTreeCoordinateHelper<D>::dist(unsigned int cellA, unsigned int cellB, unsigned int level) noexcept  {
+template<unsigned int D, typename CellId>
+double SpatialTreeCoordinateHelper<D, CellId>::dist(CellId cellA, CellId cellB, unsigned int level) noexcept  {
     // first work with integer d dimensional index
-    const auto coordA = BitManipulation<D>::extract(cellOfLevel(cellA));
-    const auto coordB = BitManipulation<D>::extract(cellOfLevel(cellB));
+    const auto coordA = BitManipulation<D, CellId>::extract(cellOfLevel(cellA));
+    const auto coordB = BitManipulation<D, CellId>::extract(cellOfLevel(cellB));
 
-    auto result = 0;
+    auto result = 0ll;
     for(auto d=0u; d<D; ++d){
-        auto dist = std::abs(static_cast<int>(coordA[d]) - static_cast<int>(coordB[d]));
-        dist = std::min(dist, (1<<level) - dist);
+        auto dist = std::abs(static_cast<long long>(coordA[d]) - static_cast<long long>(coordB[d]));
+        dist = std::min(dist, (1ll<<level) - dist);
         result = std::max(result, dist);
     }
 
     // then apply the diameter
-    auto diameter = 1.0 / (1<<level);
+    auto diameter = 1.0 / (1ll<<level);
     return std::max(0.0, (result-1) * diameter); // TODO if cellA and cellB are not touching, this max is irrelevant
 }
 } // namespace girgs
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <girgs/girgs_api.h>
+
+
+namespace girgs {
+
+/**
+ * @brief
+ *  Saves the graph as a text edge list: a line "n m", an empty line, and one line "u v" per edge.
+ *  The output is the same as writing the values with an std::ofstream, but the lines are formatted
+ *  by all OpenMP threads in parallel and written at precomputed offsets (pwrite on POSIX systems).
+ *
+ * @param edges
+ *  An edge list with zero based indices.
+ * @param n
+ *  The number of nodes.
+ * @param file
+ *  The name of the output file (with extension).
+ *
+ * @throw std::runtime_error
+ *  If the file cannot be written.
+ */
+GIRGS_API void saveEdgeList(const std::vector<std::pair<int,int>>& edges, long long n, const std::string& file);
+
+/// Same as saveEdgeList(const std::vector<std::pair<int,int>>&, long long, const std::string&) for 64 bit node indices.
+GIRGS_API void saveEdgeList(const std::vector<std::pair<int64_t,int64_t>>& edges, long long n, const std::string& file);
+
+/**
+ * @brief
+ *  Saves one line per node with the node's value in each column, separated by spaces, e.g. the
+ *  radii and angles of a hyperbolic random graph (.hyp).
+ *  The values are written like an std::ofstream with std::fixed and std::setprecision(6) does.
+ *  Formatting and writing is parallel as in saveEdgeList().
+ *
+ * @param columns
+ *  Pointers to n values each.
+ * @param n
+ *  The number of nodes.
+ * @param file
+ *  The name of the output file (with extension).
+ *
+ * @throw std::runtime_error
+ *  If the file cannot be written.
+ */
+GIRGS_API void saveColumns(const std::vector<const double*>& columns, long long n, const std::string& file);
+
+} // namespace girgs
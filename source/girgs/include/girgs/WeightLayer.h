@@ -14,10 +14,14 @@ namespace girgs {
  *
  * @tparam D
  *  the dimension of the geometry
+ * @tparam CellId
+ *  the type of cell ids (see SpatialTreeCoordinateHelper)
+ * @tparam NodeId
+ *  the type of node indices; also used for the prefix sums into the node array
  */
-template<unsigned int D>
+template<unsigned int D, typename CellId = uint32_t, typename NodeId = int>
 class WeightLayer {
-    using Helper = SpatialTreeCoordinateHelper<D>;
+    using Helper = SpatialTreeCoordinateHelper<D, CellId>;
 
 public:
     WeightLayer() = delete;
@@ -29,8 +33,8 @@ public:
     WeightLayer& operator=(WeightLayer&&) = default;
 
     WeightLayer(unsigned int targetLevel,
-                const Node<D>* base,
-                const unsigned int* prefix_sum)
+                const Node<D, CellId, NodeId>* base,
+                const NodeId* prefix_sum)
         : m_target_level{targetLevel},
           m_base{base}, 
           m_prefix_sums{prefix_sum}
@@ -48,10 +52,10 @@ public:
      * @return
      *  Returns how many points there are in cells {begin..end} using prefix sums. Begin and end are the first/last descendants of cell in target level.
      */
-    int pointsInCell(unsigned int cell, unsigned int level) const {
+    NodeId pointsInCell(CellId cell, unsigned int level) const {
         auto cellBoundaries = levelledCell(cell, level);
-        assert(cellBoundaries.first  + Helper::firstCellOfLevel(level) < Helper::firstCellOfLevel(m_target_level+1));
-        assert(cellBoundaries.second + Helper::firstCellOfLevel(level) < Helper::firstCellOfLevel(m_target_level+1));
+        assert(cellBoundaries.first  < Helper::numCellsInLevel(m_target_level));
+        assert(cellBoundaries.second < Helper::numCellsInLevel(m_target_level));
 
         return m_prefix_sums[cellBoundaries.second+1] - m_prefix_sums[cellBoundaries.first];
     }
@@ -75,7 +79,7 @@ public:
      * @return
      *  Returns the requested node.
      */
-    const Node<D>& kthPoint(unsigned int cell, unsigned int level, int k) const {
+    const Node<D, CellId, NodeId>& kthPoint(CellId cell, unsigned int level, NodeId k) const {
         auto cellBoundaries = levelledCell(cell, level);
         return m_base[m_prefix_sums[cellBoundaries.first] + k];
     }
@@ -93,7 +97,7 @@ public:
      * @return
      *  {begin, end}
      */
-    std::pair<const Node<D>*, const Node<D>*> cellIterators(unsigned int cell, unsigned int level) const {
+    std::pair<const Node<D, CellId, NodeId>*, const Node<D, CellId, NodeId>*> cellIterators(CellId cell, unsigned int level) const {
         auto cellBoundaries = levelledCell(cell, level);
         const auto begin_end = std::make_pair(m_base + m_prefix_sums[cellBoundaries.first],
                                               m_base + m_prefix_sums[cellBoundaries.second+1]);
@@ -103,7 +107,7 @@ public:
 
 protected:
 
-    std::pair<unsigned int, unsigned int> levelledCell(unsigned int cell, unsigned int level) const {
+    std::pair<CellId, CellId> levelledCell(CellId cell, unsigned int level) const {
         assert(level <= m_target_level);
         assert(Helper::firstCellOfLevel(level) <= cell && cell < Helper::firstCellOfLevel(level + 1)); // cell is from fromLevel
 
@@ -123,8 +127,8 @@ protected:
 protected:
 
     const unsigned int  m_target_level;     ///< the insertion level for the current weight layer (v(i) = wiw0/W)
-    const Node<D>*      m_base;             ///< sorted array of all nodes
-    const unsigned int* m_prefix_sums;      ///< for each cell c in target level: sum of nodes in m_base before first node in c
+    const Node<D, CellId, NodeId>* m_base;          ///< sorted array of all nodes
+    const NodeId*       m_prefix_sums;      ///< for each cell c in target level: sum of nodes in m_base before first node in c
 };
 
 } // namespace girgs
@@ -0,0 +1,267 @@
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include <girgs/BinaryFormat.h>
+
+
+namespace girgs {
+
+constexpr uint32_t BinaryHeader::kVersion;
+constexpr uint32_t BinaryHeader::kSize;
+
+namespace {
+
+// data is encoded into a buffer of this size and written in one call
+constexpr size_t kBufferSize = 1 << 20;
+
+// little-endian encoding independent of the host byte order;
+// compilers turn the loops into plain (or byte swapping) stores
+template <typename T>
+void putLE(char* dst, T value) {
+    static_assert(std::is_integral<T>::value, "use putLE(char*, double) for doubles");
+    auto x = static_cast<typename std::make_unsigned<T>::type>(value);
+    for (auto i = 0u; i < sizeof(T); ++i, x >>= 8)
+        dst[i] = static_cast<char>(x & 0xff);
+}
+
+void putLE(char* dst, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putLE(dst, bits);
+}
+
+template <typename T>
+T getLE(const char* src) {
+    static_assert(std::is_integral<T>::value, "use getLE<double> for doubles");
+    typename std::make_unsigned<T>::type x = 0;
+    for (auto i = sizeof(T); i-- > 0; )
+        x = (x << 8) | static_cast<unsigned char>(src[i]);
+    return static_cast<T>(x);
+}
+
+template <>
+double getLE<double>(const char* src) {
+    const auto bits = getLE<uint64_t>(src);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+class BufferedWriter {
+public:
+    explicit BufferedWriter(const std::string& file)
+        : m_file(file)
+        , m_stream(file, std::ios::binary | std::ios::trunc)
+        , m_buffer(kBufferSize)
+        , m_size(0)
+    {
+        if (!m_stream.is_open())
+            throw std::runtime_error{"Error: failed to open file \"" + file + '\"'};
+    }
+
+    template <typename T>
+    void put(T value) {
+        if (m_size + sizeof(T) > m_buffer.size())
+            flush();
+        putLE(m_buffer.data() + m_size, value);
+        m_size += sizeof(T);
+    }
+
+    void putBytes(const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+            put(data[i]);
+    }
+
+    void flush() {
+        m_stream.write(m_buffer.data(), m_size);
+        m_size = 0;
+        if (!m_stream)
+            throw std::runtime_error{"Error: failed to write file \"" + m_file + '\"'};
+    }
+
+private:
+    std::string m_file;
+    std::ofstream m_stream;
+    std::vector<char> m_buffer;
+    size_t m_size;
+};
+
+class BufferedReader {
+public:
+    explicit BufferedReader(const std::string& file)
+        : m_file(file)
+        , m_stream(file, std::ios::binary)
+        , m_buffer(kBufferSize)
+        , m_pos(0)
+        , m_size(0)
+    {
+        if (!m_stream.is_open())
+            throw std::runtime_error{"Error: failed to open file \"" + file + '\"'};
+        m_stream.seekg(0, std::ios::end);
+        m_file_size = static_cast<uint64_t>(m_stream.tellg());
+        m_stream.seekg(0, std::ios::beg);
+    }
+
+    /// size of the whole file in bytes
+    uint64_t fileSize() const { return m_file_size; }
+
+    template <typename T>
+    T get() {
+        if (m_pos + sizeof(T) > m_size)
+            refill(sizeof(T));
+        const auto value = getLE<T>(m_buffer.data() + m_pos);
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    void getBytes(char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+            data[i] = get<char>();
+    }
+
+private:
+    void refill(size_t required) {
+        // move the remainder to the front and read as much as fits behind it
+        std::memmove(m_buffer.data(), m_buffer.data() + m_pos, m_size - m_pos);
+        m_size -= m_pos;
+        m_pos = 0;
+        m_stream.read(m_buffer.data() + m_size, m_buffer.size() - m_size);
+        m_size += static_cast<size_t>(m_stream.gcount());
+        if (m_size < required)
+            throw std::runtime_error{"Error: file \"" + m_file + "\" is truncated"};
+    }
+
+    std::string m_file;
+    std::ifstream m_stream;
+    std::vector<char> m_buffer;
+    size_t m_pos;
+    size_t m_size;
+    uint64_t m_file_size;
+};
+
+template <typename NodeId>
+void saveBinaryImpl(const std::string& file, BinaryHeader header, const std::vector<std::pair<NodeId, NodeId>>& edges,
+        const double* weights, const double* coordinates) {
+    header.id_bytes = sizeof(NodeId);
+    header.has_nodes = weights != nullptr;
+    header.m = edges.size();
+
+    BufferedWriter out(file);
+    out.putBytes(header.magic, sizeof(header.magic));
+    out.put(header.version);
+    out.put(header.model);
+    out.put(header.id_bytes);
+    out.put(header.dimension);
+    out.put(header.has_nodes);
+    out.put(header.reserved);
+    out.put(header.n);
+    out.put(header.m);
+    out.put(header.alpha);
+    out.put(header.ple);
+    out.put(header.avg_degree);
+    out.put(header.temperature);
+    out.put(header.radius);
+    out.put(header.weight_scaling);
+    for (auto seed : header.seeds)
+        out.put(seed);
+    out.put(header.reserved2);
+
+    for (const auto& edge : edges) {
+        out.put(edge.first);
+        out.put(edge.second);
+    }
+
+    if (header.has_nodes) {
+        for (uint64_t i = 0; i < header.n; ++i)
+            out.put(weights[i]);
+        for (uint64_t i = 0; i < header.n * header.dimension; ++i)
+            out.put(coordinates[i]);
+    }
+
+    out.flush();
+}
+
+} // namespace
+
+void saveBinary(const std::string& file, const BinaryHeader& header, const std::vector<std::pair<int, int>>& edges,
+        const double* weights, const double* coordinates) {
+    saveBinaryImpl(file, header, edges, weights, coordinates);
+}
+
+void saveBinary(const std::string& file, const BinaryHeader& header, const std::vector<std::pair<int64_t, int64_t>>& edges,
+        const double* weights, const double* coordinates) {
+    saveBinaryImpl(file, header, edges, weights, coordinates);
+}
+
+BinaryGraph loadBinary(const std::string& file, bool readNodes) {
+    BinaryGraph result;
+    auto& header = result.header;
+
+    BufferedReader in(file);
+    in.getBytes(header.magic, sizeof(header.magic));
+    if (std::memcmp(header.magic, BinaryHeader().magic, sizeof(header.magic)) != 0)
+        throw std::runtime_error{"Error: file \"" + file + "\" is not a binary graph"};
+    header.version = in.get<uint32_t>();
+    if (header.version != BinaryHeader::kVersion)
+        throw std::runtime_error{"Error: file \"" + file + "\" has unsupported version " + std::to_string(header.version)};
+    header.model = in.get<uint32_t>();
+    header.id_bytes = in.get<uint32_t>();
+    header.dimension = in.get<uint32_t>();
+    header.has_nodes = in.get<uint32_t>();
+    header.reserved = in.get<uint32_t>();
+    header.n = in.get<uint64_t>();
+    header.m = in.get<uint64_t>();
+    header.alpha = in.get<double>();
+    header.ple = in.get<double>();
+    header.avg_degree = in.get<double>();
+    header.temperature = in.get<double>();
+    header.radius = in.get<double>();
+    header.weight_scaling = in.get<double>();
+    for (auto& seed : header.seeds)
+        seed = in.get<int64_t>();
+    header.reserved2 = in.get<uint64_t>();
+
+    if (header.id_bytes != 4 && header.id_bytes != 8)
+        throw std::runtime_error{"Error: file \"" + file + "\" has unsupported id width " + std::to_string(header.id_bytes)};
+
+    // check the sizes in the header before allocating anything for them
+    const auto truncated = std::runtime_error{"Error: file \"" + file + "\" is truncated"};
+    if (in.fileSize() < BinaryHeader::kSize)
+        throw truncated;
+    auto remaining = in.fileSize() - BinaryHeader::kSize;
+    const uint64_t edge_bytes = 2 * header.id_bytes;
+    if (header.m > remaining / edge_bytes)
+        throw truncated;
+    remaining -= header.m * edge_bytes;
+    const uint64_t node_bytes = (1 + static_cast<uint64_t>(header.dimension)) * sizeof(double);
+    if (header.has_nodes && readNodes && header.n > remaining / node_bytes)
+        throw truncated;
+
+    result.edges.resize(header.m);
+    if (header.id_bytes == 4) {
+        for (auto& edge : result.edges) {
+            edge.first = in.get<int32_t>();
+            edge.second = in.get<int32_t>();
+        }
+    } else {
+        for (auto& edge : result.edges) {
+            edge.first = in.get<int64_t>();
+            edge.second = in.get<int64_t>();
+        }
+    }
+
+    if (header.has_nodes && readNodes) {
+        result.weights.resize(header.n);
+        for (auto& each : result.weights)
+            each = in.get<double>();
+        result.coordinates.resize(header.n * header.dimension);
+        for (auto& each : result.coordinates)
+            each = in.get<double>();
+    }
+
+    return result;
+}
+
+} // namespace girgs
@@ -3,30 +3,40 @@
 #include <iomanip>
 #include <random>
 #include <functional>
-#include <mutex>
 #include <ios>
+#include <cassert>
 
 #include <omp.h>
 
 #include <girgs/Generator.h>
+#include <girgs/EdgeBlocks.h>
+#include <girgs/Random.h>
 #include <girgs/SpatialTree.h>
 #include <girgs/WeightScaling.h>
 
 
 namespace girgs {
 
-std::vector<double> generateWeights(int n, double ple, int weightSeed, bool parallel) {
-    const auto threads = parallel ? std::max(1, std::min(omp_get_max_threads(), n / 10000)) : 1;
+// Nodes are sampled in blocks of this size. Each block has its own generator seeded
+// from the seed and the block index, s.t. the result does not depend on the number of threads.
+constexpr long long kSampleBlockSize = 1 << 16;
+
+static default_random_engine blockGenerator(int seed, long long block) {
+    return default_random_engine{seed >= 0 ? streamKey(static_cast<uint64_t>(seed), block) : std::random_device()()};
+}
+
+std::vector<double> generateWeights(long long n, double ple, int weightSeed, bool parallel) {
+    const auto threads = parallel ? static_cast<int>(std::max(1ll, std::min<long long>(omp_get_max_threads(), n / 10000))) : 1;
+    const auto blocks = (n + kSampleBlockSize - 1) / kSampleBlockSize;
     auto result = std::vector<double>(n);
 
-    #pragma omp parallel num_threads(threads)
-    {
-        const auto tid = omp_get_thread_num();
-        auto gen = default_random_engine{weightSeed >= 0 ? (weightSeed+tid) : std::random_device()()};
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long long block = 0; block < blocks; ++block) {
+        auto gen = blockGenerator(weightSeed, block);
         auto dist = std::uniform_real_distribution<>{};
 
-        #pragma omp for schedule(static)
-        for (int i = 0; i < n; ++i) {
+        const auto end = std::min(n, (block + 1) * kSampleBlockSize);
+        for (auto i = block * kSampleBlockSize; i < end; ++i) {
             result[i] = std::pow((std::pow(0.5*n, -ple + 1) - 1) * dist(gen) + 1, 1 / (-ple + 1));
         }
     }
@@ -34,25 +44,37 @@ std::vector<double> generateWeights(int n, double ple, int weightSeed, bool para
     return result;
 }
 
-std::vector<std::vector<double>> generatePositions(int n, int dimension, int positionSeed, bool parallel) {
-    const auto threads = parallel ? std::max(1, std::min(omp_get_max_threads(), n / 10000)) : 1;
-    auto result = std::vector<std::vector<double>>(n, std::vector<double>(dimension));
+// coordinates(i) returns a pointer to the dimension coordinates of node i
+template <typename Coordinates>
+static void samplePositions(long long n, int dimension, int positionSeed, bool parallel, Coordinates coordinates) {
+    const auto threads = parallel ? static_cast<int>(std::max(1ll, std::min<long long>(omp_get_max_threads(), n / 10000))) : 1;
+    const auto blocks = (n + kSampleBlockSize - 1) / kSampleBlockSize;
 
-    #pragma omp parallel num_threads(threads)
-    {
-        const auto tid = omp_get_thread_num();
-        auto gen = default_random_engine{positionSeed >= 0 ? (positionSeed+tid) : std::random_device()()};
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long long block = 0; block < blocks; ++block) {
+        auto gen = blockGenerator(positionSeed, block);
         auto dist = std::uniform_real_distribution<>{};
 
-        #pragma omp for schedule(static)
-        for(int i=0; i<n; ++i)
+        const auto end = std::min(n, (block + 1) * kSampleBlockSize);
+        for (auto i = block * kSampleBlockSize; i < end; ++i) {
+            auto coord = coordinates(i);
             for (int d=0; d<dimension; ++d)
-                result[i][d] = dist(gen);
+                coord[d] = dist(gen);
+        }
     }
+}
 
+std::vector<std::vector<double>> generatePositions(long long n, int dimension, int positionSeed, bool parallel) {
+    auto result = std::vector<std::vector<double>>(n, std::vector<double>(dimension));
+    samplePositions(n, dimension, positionSeed, parallel, [&result] (long long i) { return result[i].data(); });
     return result;
 }
 
+void generatePositions(long long n, int dimension, int positionSeed, double* positions, size_t stride, bool parallel) {
+    assert(stride >= static_cast<size_t>(dimension));
+    samplePositions(n, dimension, positionSeed, parallel, [positions, stride] (long long i) { return positions + i * stride; });
+}
+
 double scaleWeights(std::vector<double>& weights, double desiredAvgDegree, int dimension, double alpha) {
     // estimate scaling with binary search
     double scaling;
@@ -69,69 +91,133 @@ double scaleWeights(std::vector<double>& weights, double desiredAvgDegree, int d
     return scaling;
 }
 
+// positions are either a vector of coordinate vectors or a pointer, the dimension and a stride
+template <typename NodeId, typename... Positions>
+static std::vector<std::pair<NodeId, NodeId>> generateEdgeList(const std::vector<double> &weights, double alpha, int samplingSeed,
+        const Positions&... positions) {
+
+    EdgeBlocks<NodeId> blocks;
+    generateEdges<NodeId>(weights, positions..., alpha, samplingSeed, blocks);
+    return blocks.merge();
+}
+
 std::vector<std::pair<int, int>> generateEdges(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
         double alpha, int samplingSeed) {
+    return generateEdgeList<int>(weights, alpha, samplingSeed, positions);
+}
 
-    using edge_vector = std::vector<std::pair<int, int>>;
-    edge_vector result;
-
-    std::vector<std::pair<
-            edge_vector,
-            uint64_t[31] /* avoid false sharing */
-    > > local_edges(omp_get_max_threads());
+std::vector<std::pair<int64_t, int64_t>> generateEdges64(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
+        double alpha, int samplingSeed) {
+    return generateEdgeList<int64_t>(weights, alpha, samplingSeed, positions);
+}
 
-    constexpr auto block_size = size_t{1} << 20;
+std::vector<std::pair<int, int>> generateEdges(const std::vector<double> &weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed) {
+    return generateEdgeList<int>(weights, alpha, samplingSeed, positions, dimension, stride);
+}
 
-    std::mutex m;
-    auto flush = [&] (const edge_vector& local) {
-        std::lock_guard<std::mutex> lock(m);
-        result.insert(result.end(), local.cbegin(), local.cend());
-    };
+std::vector<std::pair<int64_t, int64_t>> generateEdges64(const std::vector<double> &weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed) {
+    return generateEdgeList<int64_t>(weights, alpha, samplingSeed, positions, dimension, stride);
+}
 
-    auto addEdge = [&](int u, int v, int tid) {
-        auto& local = local_edges[tid].first;
-        local.emplace_back(u,v);
-        if (local.size() == block_size) {
-            flush(local);
-            local.clear();
-        }
-    };
-
-    auto dimension = positions.front().size();
-
-    switch(dimension) {
-        case 1: makeSpatialTree<1>(weights, positions, alpha, addEdge).generateEdges(samplingSeed); break;
-        case 2: makeSpatialTree<2>(weights, positions, alpha, addEdge).generateEdges(samplingSeed); break;
-        case 3: makeSpatialTree<3>(weights, positions, alpha, addEdge).generateEdges(samplingSeed); break;
-        case 4: makeSpatialTree<4>(weights, positions, alpha, addEdge).generateEdges(samplingSeed); break;
-        case 5: makeSpatialTree<5>(weights, positions, alpha, addEdge).generateEdges(samplingSeed); break;
-        default:
-            std::cout << "Dimension " << dimension << " not supported." << std::endl;
-            std::cout << "No edges generated." << std::endl;
-            break;
+// counts the edges in the first pass and adds them in the second
+template <typename NodeId>
+struct CSREdgeCallback {
+    CSRBuilder<NodeId>& builder;
+    bool filling;
+
+    void operator()(NodeId u, NodeId v, int) {
+        if (filling)
+            builder.add(u, v);
+        else
+            builder.count(u, v);
+    }
+};
+
+template <typename NodeId>
+struct SampleTwice {
+    CSREdgeCallback<NodeId>& addEdge;
+    int samplingSeed;
+
+    template <typename Tree>
+    void operator()(Tree& tree) const {
+        tree.generateEdges(samplingSeed);
+        addEdge.builder.allocate();
+        addEdge.filling = true;
+        tree.generateEdges(samplingSeed);
     }
+};
 
-    for(const auto& v : local_edges)
-        flush(v.first);
+// builds the tree for the positions and passes it to sample(tree)
+template <typename NodeId, typename Sample, typename EdgeCallback>
+static void sampleTree(const std::vector<double> &weights, double alpha, const Sample& sample, EdgeCallback& edgeCallback,
+        const std::vector<std::vector<double>> &positions) {
+    detail::generateEdgesForDimension<NodeId>(positions.front().size(), weights, alpha, sample, edgeCallback, positions);
+}
 
-    return result;
+template <typename NodeId, typename Sample, typename EdgeCallback>
+static void sampleTree(const std::vector<double> &weights, double alpha, const Sample& sample, EdgeCallback& edgeCallback,
+        const double* positions, int dimension, size_t stride) {
+    detail::generateEdgesForDimension<NodeId>(dimension, weights, alpha, sample, edgeCallback, positions, stride);
 }
 
+// positions are either a vector of coordinate vectors or a pointer, the dimension and a stride
+template <typename NodeId, typename... Positions>
+static CSRGraph<NodeId> generateCSRImpl(const std::vector<double> &weights, double alpha, int samplingSeed, bool symmetric,
+        const Positions&... positions) {
 
-void saveDot(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
-             const std::vector<std::pair<int, int>> &graph, const std::string &file) {
+    // both passes have to sample the same graph
+    if (samplingSeed < 0)
+        samplingSeed = static_cast<int>(std::random_device{}() >> 1);
+
+    CSRBuilder<NodeId> builder(weights.size(), symmetric);
+    CSREdgeCallback<NodeId> addEdge{builder, false};
+
+    // the tree is built once and sampled twice
+    sampleTree<NodeId>(weights, alpha, SampleTwice<NodeId>{addEdge, samplingSeed}, addEdge, positions...);
+
+    return builder.finish();
+}
+
+CSRGraph<int> generateCSR(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
+        double alpha, int samplingSeed, bool symmetric) {
+    return generateCSRImpl<int>(weights, alpha, samplingSeed, symmetric, positions);
+}
+
+CSRGraph<int64_t> generateCSR64(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
+        double alpha, int samplingSeed, bool symmetric) {
+    return generateCSRImpl<int64_t>(weights, alpha, samplingSeed, symmetric, positions);
+}
+
+CSRGraph<int> generateCSR(const std::vector<double> &weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed, bool symmetric) {
+    return generateCSRImpl<int>(weights, alpha, samplingSeed, symmetric, positions, dimension, stride);
+}
+
+CSRGraph<int64_t> generateCSR64(const std::vector<double> &weights, const double* positions, int dimension, size_t stride,
+        double alpha, int samplingSeed, bool symmetric) {
+    return generateCSRImpl<int64_t>(weights, alpha, samplingSeed, symmetric, positions, dimension, stride);
+}
+
+
+// coordinates(i) returns a pointer to the dimension coordinates of node i
+template <typename Coordinates, typename NodeId>
+static void saveDotImpl(const std::vector<double> &weights, Coordinates coordinates, size_t dimension,
+             const std::vector<std::pair<NodeId, NodeId>> &graph, const std::string &file) {
 
     std::ofstream f{file};
     if(!f.is_open())
         throw std::runtime_error{"Error: failed to open file \"" + file + '\"'};
     f << "graph girg {\n\toverlap=scale;\n\n";
     f << std::fixed;
-    for (int i = 0; i < weights.size(); ++i) {
+    for (size_t i = 0; i < weights.size(); ++i) {
         f << '\t' << i << " [label=\""
           << std::setprecision(2) << weights[i] << std::setprecision(6)
           << "\", pos=\"";
-        for (auto d = 0u; d < positions[i].size(); ++d)
-            f << (d == 0 ? "" : ",") << positions[i][d];
+        const auto coord = coordinates(i);
+        for (auto d = 0u; d < dimension; ++d)
+            f << (d == 0 ? "" : ",") << coord[d];
         f << "\"];\n";
     }
     f << '\n';
@@ -140,4 +226,24 @@ void saveDot(const std::vector<double> &weights, const std::vector<std::vector<d
     f << "}\n";
 }
 
+void saveDot(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
+             const std::vector<std::pair<int, int>> &graph, const std::string &file) {
+    saveDotImpl(weights, [&positions] (size_t i) { return positions[i].data(); }, positions.front().size(), graph, file);
+}
+
+void saveDot(const std::vector<double> &weights, const std::vector<std::vector<double>> &positions,
+             const std::vector<std::pair<int64_t, int64_t>> &graph, const std::string &file) {
+    saveDotImpl(weights, [&positions] (size_t i) { return positions[i].data(); }, positions.front().size(), graph, file);
+}
+
+void saveDot(const std::vector<double> &weights, const double* positions, int dimension, size_t stride,
+             const std::vector<std::pair<int, int>> &graph, const std::string &file) {
+    saveDotImpl(weights, [positions, stride] (size_t i) { return positions + i * stride; }, dimension, graph, file);
+}
+
+void saveDot(const std::vector<double> &weights, const double* positions, int dimension, size_t stride,
+             const std::vector<std::pair<int64_t, int64_t>> &graph, const std::string &file) {
+    saveDotImpl(weights, [positions, stride] (size_t i) { return positions + i * stride; }, dimension, graph, file);
+}
+
 } // namespace girgs
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <fstream>
+#include <mutex>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <omp.h>
+
+#include <girgs/TextFormat.h>
+
+
+namespace girgs {
+
+namespace {
+
+// lines are formatted in chunks of this many items; each thread formats one chunk per round
+constexpr size_t kChunkItems = 1 << 16;
+
+// the longest output of "%.6f" for a double: 309 integral digits, sign, point and 6 decimals
+constexpr size_t kMaxFixedBytes = 320;
+
+const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// writes value in decimal, like std::ostream does, and returns the end of the output
+template <typename T>
+char* formatInt(T value, char* out) {
+    using U = typename std::make_unsigned<T>::type;
+    auto x = static_cast<U>(value);
+    if (value < 0) {
+        *out++ = '-';
+        x = U(0) - x;
+    }
+
+    char digits[24];
+    auto begin = digits + sizeof(digits);
+    while (x >= 100) {
+        const auto pair = static_cast<size_t>(x % 100) * 2;
+        x /= 100;
+        begin -= 2;
+        std::memcpy(begin, kDigitPairs + pair, 2);
+    }
+    if (x >= 10) {
+        begin -= 2;
+        std::memcpy(begin, kDigitPairs + static_cast<size_t>(x) * 2, 2);
+    } else {
+        *--begin = static_cast<char>('0' + x);
+    }
+
+    const auto length = static_cast<size_t>(digits + sizeof(digits) - begin);
+    std::memcpy(out, begin, length);
+    return out + length;
+}
+
+// writes value like std::ostream with std::fixed and std::setprecision(6)
+char* formatFixed(double value, char* out) {
+    return out + std::snprintf(out, kMaxFixedBytes, "%.6f", value);
+}
+
+// file that is written at explicit offsets by several threads concurrently
+class OutputFile {
+public:
+    explicit OutputFile(const std::string& file) : m_file(file) {
+#ifdef _WIN32
+        m_stream.open(file, std::ios::binary | std::ios::trunc);
+        if (!m_stream.is_open())
+#else
+        m_fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0)
+#endif
+            throw std::runtime_error{"Error: failed to open file \"" + file + '\"'};
+    }
+
+    ~OutputFile() {
+#ifndef _WIN32
+        ::close(m_fd);
+#endif
+    }
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    // returns false on failure
+    bool write(const char* data, size_t size, uint64_t offset) {
+#ifdef _WIN32
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stream.seekp(offset);
+        m_stream.write(data, size);
+        return static_cast<bool>(m_stream);
+#else
+        while (size > 0) {
+            const auto written = ::pwrite(m_fd, data, size, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            data += written;
+            size -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+#endif
+    }
+
+    const std::string& name() const { return m_file; }
+
+private:
+    std::string m_file;
+#ifdef _WIN32
+    std::ofstream m_stream;
+    std::mutex m_mutex;
+#else
+    int m_fd;
+#endif
+};
+
+// Writes the header followed by the text of items [0, items).
+// format(i, out) writes at most maxItemBytes bytes for item i to out and returns the end of its output.
+// In each round, every thread formats one chunk into a private buffer; a prefix sum over the chunk sizes
+// yields the offsets at which the threads write their buffers concurrently.
+template <typename Format>
+void writeParallel(const std::string& file, const std::string& header, size_t items, size_t maxItemBytes, Format format) {
+    OutputFile out(file);
+    auto failed = !out.write(header.data(), header.size(), 0);
+
+    const auto chunks = (items + kChunkItems - 1) / kChunkItems;
+    const auto threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(omp_get_max_threads(), chunks)));
+    auto sizes = std::vector<size_t>(threads);
+    uint64_t base = header.size();
+
+    #pragma omp parallel num_threads(threads)
+    {
+        const auto tid = omp_get_thread_num();
+        auto buffer = std::vector<char>(kChunkItems * std::min<size_t>(maxItemBytes, 64));
+
+        for (size_t round = 0; round * threads < chunks; ++round) {
+            const auto chunk = round * threads + tid;
+            size_t size = 0;
+            if (chunk < chunks) {
+                const auto end = std::min(items, (chunk + 1) * kChunkItems);
+                for (auto i = chunk * kChunkItems; i < end; ++i) {
+                    if (buffer.size() - size < maxItemBytes)
+                        buffer.resize(2 * buffer.size() + maxItemBytes);
+                    size = static_cast<size_t>(format(i, buffer.data() + size) - buffer.data());
+                }
+            }
+            sizes[tid] = size;
+
+            #pragma omp barrier
+
+            auto offset = base;
+            for (int t = 0; t < tid; ++t)
+                offset += sizes[t];
+            if (size > 0 && !out.write(buffer.data(), size, offset)) {
+                #pragma omp critical
+                failed = true;
+            }
+
+            #pragma omp barrier
+
+            #pragma omp single
+            for (int t = 0; t < threads; ++t)
+                base += sizes[t];
+        }
+    }
+
+    if (failed)
+        throw std::runtime_error{"Error: failed to write file \"" + out.name() + '\"'};
+}
+
+template <typename NodeId>
+void saveEdgeListImpl(const std::vector<std::pair<NodeId, NodeId>>& edges, long long n, const std::string& file) {
+    const auto header = std::to_string(n) + ' ' + std::to_string(edges.size()) + "\n\n";
+    // two ids with sign, the separator and the newline
+    const auto maxLineBytes = 2 * 21 + 2;
+    writeParallel(file, header, edges.size(), maxLineBytes, [&edges] (size_t i, char* out) -> char* {
+        out = formatInt(edges[i].first, out);
+        *out++ = ' ';
+        out = formatInt(edges[i].second, out);
+        *out++ = '\n';
+        return out;
+    });
+}
+
+} // namespace
+
+void saveEdgeList(const std::vector<std::pair<int, int>>& edges, long long n, const std::string& file) {
+    saveEdgeListImpl(edges, n, file);
+}
+
+void saveEdgeList(const std::vector<std::pair<int64_t, int64_t>>& edges, long long n, const std::string& file) {
+    saveEdgeListImpl(edges, n, file);
+}
+
+void saveColumns(const std::vector<const double*>& columns, long long n, const std::string& file) {
+    const auto maxLineBytes = columns.size() * (kMaxFixedBytes + 1) + 1;
+    writeParallel(file, "", static_cast<size_t>(n), maxLineBytes, [&columns] (size_t i, char* out) -> char* {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (c > 0)
+                *out++ = ' ';
+            out = formatFixed(columns[c][i], out);
+        }
+        *out++ = '\n';
+        return out;
+    });
+}
+
+} // namespace girgs
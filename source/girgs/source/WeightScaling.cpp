@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <limits>
 #include <cassert>
 #include <functional>
 #include <numeric>
@@ -86,14 +87,14 @@ double estimateWeightScalingThreshold(const std::vector<double> &weights, double
     LazySorter lazy_sorter(sweights);
 
     // compute some constant stuff
-    const auto n = weights.size();
+    const auto n = static_cast<long long>(weights.size());
     auto max_weight = 0.0;
     auto W = 0.0, sq_W = 0.0;
     {
 #ifndef _MSC_VER
         #pragma omp parallel for reduction(+:W, sq_W), reduction(max: max_weight)
 #endif
-        for (int i = 0; i < n; ++i) {
+        for (long long i = 0; i < n; ++i) {
             const auto each = weights[i];
             sweights[i] = each; // copy to sweights
 
@@ -175,7 +176,7 @@ double estimateWeightScaling(const std::vector<double> &weights, double desiredA
     // = sum_{u\in V} wu^\alpha sum_{v\in V} (wv/W)^\alpha
     auto sum_wwW_a = 0.0;
     auto max_w = 0.;
-    const auto n = static_cast<int>(weights.size());
+    const auto n = static_cast<long long>(weights.size());
 
     // this loop causes >= 70% of runtime
     std::vector<double> sweights(n);
@@ -184,7 +185,7 @@ double estimateWeightScaling(const std::vector<double> &weights, double desiredA
 #ifndef _MSC_VER
         #pragma omp parallel for reduction(+:sum_sq_w, sum_w_a, sum_sq_w_a, sum_wwW_a), reduction(max:max_w)
 #endif
-        for (int i = 0; i < n; ++i) {
+        for (long long i = 0; i < n; ++i) {
             const auto each = weights[i];
             sweights[i] = each; // copy in parallel
 
@@ -215,7 +216,7 @@ double estimateWeightScaling(const std::vector<double> &weights, double desiredA
 
         const auto rich_thresh = std::exp(dimension * std::log(0.5 / std::pow(c, 1.0 / alpha / dimension)) - log(max_w_W));
         const auto richclub_end = lazy_sorter.sort_downto(rich_thresh);
-        const auto num_richclub = static_cast<int>(std::distance(sweights.begin(), richclub_end));
+        const auto num_richclub = static_cast<long long>(std::distance(sweights.begin(), richclub_end));
 
         if (!num_richclub)
             return long_and_short_with_error / n;
@@ -231,7 +232,7 @@ double estimateWeightScaling(const std::vector<double> &weights, double desiredA
         // get error for long and short edges
         const auto thresh = std::exp( (std::log(0.5) * dimension - std::log(c) / alpha) );
 
-        int i2 = 0;
+        long long i2 = 0;
         auto w2_sum       = 0.0;
         long double w2_alpha_sum = 0.0;
 
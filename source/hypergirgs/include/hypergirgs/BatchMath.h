@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+
+namespace hypergirgs {
+
+/**
+ * @brief
+ *  Branch-free polynomial approximations of the transcendental functions needed to precompute a Point.
+ *  In contrast to the calls into libm they are inlined, so loops over them are vectorized
+ *  (e.g. 4 doubles per instruction with OPTION_USE_AVX2).
+ *  The approximations are accurate to a few ulp (see Point_test).
+ */
+namespace batch_math {
+
+/// number of points processed per call of pointTerms; fits the terms into the L1 cache
+constexpr unsigned int batch_size = 256;
+
+inline uint64_t toBits(double x) noexcept {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+inline double fromBits(uint64_t bits) noexcept {
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/// the bits of a where mask is set and the bits of b elsewhere
+inline double blend(uint64_t mask, double a, double b) noexcept {
+    return fromBits((toBits(a) & mask) | (toBits(b) & ~mask));
+}
+
+/// condition ? a : b with bit operations rather than a branch; GCC does not if-convert all ternaries in a loop
+inline double select(bool condition, double a, double b) noexcept {
+    return blend(uint64_t{0} - static_cast<uint64_t>(condition), a, b);
+}
+
+// adding this constant rounds a double |x| < 2^51 to an integer, which is then found in the low bits of the mantissa
+constexpr double kRoundMagic = 6755399441055744.0; // 1.5 * 2^52
+
+/// exp(x) for -708 <= x <= 0 (clamped to this range)
+inline double negExp(double x) noexcept {
+    constexpr double kLog2e = 1.4426950408889634;
+    constexpr double kLn2Hi = 6.93147180369123816490e-01; // upper bits of ln(2), s.t. k*kLn2Hi is exact
+    constexpr double kLn2Lo = 1.90821492927058770002e-10;
+
+    x = select(x < -708.0, -708.0, select(x > 0.0, 0.0, x));
+
+    // x = k*ln(2) + y with |y| <= ln(2)/2
+    const auto kd = x * kLog2e + kRoundMagic;
+    const auto k = kd - kRoundMagic;
+    const auto y = (x - k * kLn2Hi) - k * kLn2Lo;
+
+    // Taylor series up to y^13; the remainder is below 1e-17
+    auto p = 1.0 / 6227020800.0;
+    p = p * y + 1.0 / 479001600.0;
+    p = p * y + 1.0 / 39916800.0;
+    p = p * y + 1.0 / 3628800.0;
+    p = p * y + 1.0 / 362880.0;
+    p = p * y + 1.0 / 40320.0;
+    p = p * y + 1.0 / 5040.0;
+    p = p * y + 1.0 / 720.0;
+    p = p * y + 1.0 / 120.0;
+    p = p * y + 1.0 / 24.0;
+    p = p * y + 1.0 / 6.0;
+    p = p * y + 0.5;
+    p = p * y + 1.0;
+    p = p * y + 1.0;
+
+    // multiply by 2^k by adding k to the exponent
+    const auto k_bits = toBits(kd) - toBits(kRoundMagic);
+    return fromBits(toBits(p) + (k_bits << 52));
+}
+
+/// sinh(x) for 0 <= x <= 0.5
+inline double smallSinh(double x) noexcept {
+    // Taylor series up to x^15; the remainder is below 1e-19 * x
+    const auto z = x * x;
+    auto p = 1.0 / 1307674368000.0;
+    p = p * z + 1.0 / 6227020800.0;
+    p = p * z + 1.0 / 39916800.0;
+    p = p * z + 1.0 / 362880.0;
+    p = p * z + 1.0 / 5040.0;
+    p = p * z + 1.0 / 120.0;
+    p = p * z + 1.0 / 6.0;
+    return x + x * z * p;
+}
+
+/// sin(a) and cos(a) for 0 <= a < 2*pi
+inline void sinCos(double a, double& sin_a, double& cos_a) noexcept {
+    // pi/2 split into parts of 33 bits (as in fdlibm), s.t. q*kPio2_1 and q*kPio2_2 are exact for small q
+    constexpr double kInvPio2 = 6.36619772367581382433e-01;
+    constexpr double kPio2_1 = 1.57079632673412561417e+00;
+    constexpr double kPio2_2 = 6.07710050630396597660e-11;
+    constexpr double kPio2_3 = 2.02226624871116645580e-21;
+
+    // a = q*pi/2 + y with |y| <= pi/4
+    const auto qd = a * kInvPio2 + kRoundMagic;
+    const auto q_bits = toBits(qd) - toBits(kRoundMagic);
+    const auto q = qd - kRoundMagic;
+    const auto y = ((a - q * kPio2_1) - q * kPio2_2) - q * kPio2_3;
+    const auto z = y * y;
+
+    // minimax polynomials of fdlibm's __kernel_sin and __kernel_cos on [-pi/4, pi/4]
+    auto s = 1.58969099521155010221e-10;
+    s = s * z - 2.50507602534068634195e-08;
+    s = s * z + 2.75573137070700676789e-06;
+    s = s * z - 1.98412698298579493134e-04;
+    s = s * z + 8.33333333332248946124e-03;
+    s = s * z - 1.66666666666666324348e-01;
+    const auto sin_y = y + y * z * s;
+
+    auto c = -1.13596475577881948265e-11;
+    c = c * z + 2.08757232129817482790e-09;
+    c = c * z - 2.75573143513906633035e-07;
+    c = c * z + 2.48015872894767294178e-05;
+    c = c * z - 1.38888888888741095749e-03;
+    c = c * z + 4.16666666666666019037e-02;
+    const auto hz = 0.5 * z;
+    const auto w = 1.0 - hz;
+    const auto cos_y = w + (((1.0 - w) - hz) + z * z * c);
+
+    // rotate by q quadrants
+    const auto swap = uint64_t{0} - (q_bits & 1);
+    sin_a = fromBits(toBits(blend(swap, cos_y, sin_y)) ^ ((q_bits & 2) << 62));
+    cos_a = fromBits(toBits(blend(swap, sin_y, cos_y)) ^ (((q_bits + 1) & 2) << 62));
+}
+
+/**
+ * @brief
+ *  Computes the precomputed terms of Point for count <= batch_size points.
+ *
+ * @param radii, angles
+ *  Input: 0 <= radii[k] < 708 and 0 <= angles[k] < 2*pi.
+ * @param invsinh_r, coth_r, cos_phi, sin_phi
+ *  Output: 1/sinh(radii[k]), coth(radii[k]), cos(angles[k]) and sin(angles[k]).
+ */
+inline void pointTerms(const double* radii, const double* angles, unsigned int count,
+                       double* invsinh_r, double* coth_r, double* cos_phi, double* sin_phi) noexcept {
+    assert(count <= batch_size);
+
+    #pragma omp simd
+    for (auto k = 0u; k < count; ++k) {
+        const auto r = radii[k];
+
+        // m = exp(-r) does not overflow, so sinh(r) = (1/m - m)/2 and cosh(r) = (1/m + m)/2 are rewritten in m.
+        // For small r the difference cancels; there the Taylor series of sinh takes over.
+        const auto m = negExp(-r);
+        const auto m2 = m * m;
+        const auto large = r > 0.5;
+        const auto s = smallSinh(select(large, 0.5, r));
+        const auto denom = select(large, 1.0 - m2, 2.0 * m * s);
+        invsinh_r[k] = select(large, 2.0 * m / denom, 1.0 / s);
+        coth_r[k] = (1.0 + m2) / denom;
+
+        sinCos(angles[k], sin_phi[k], cos_phi[k]);
+    }
+}
+
+} // namespace batch_math
+
+} // namespace hypergirgs
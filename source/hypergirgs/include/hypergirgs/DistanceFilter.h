@@ -1,6 +1,8 @@
 #pragma once
 
-#include <array>
+#include <vector>
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <limits>
 
@@ -10,13 +12,13 @@ namespace hypergirgs {
 /**
  * The filter should be used to compute bounds on the hyperbolic distance (or rather the cosh of it),
  * such that vertices with this distance are guaranteed to be connected/disconnected.
- *
- * @tparam stages
- *  The resolution of the filter (i.e. number of entries).
+ * A pair can only not be decided if its connection probability falls into the same stage as the random number,
+ * which happens for about 1/stages of the queries.
  */
-template<size_t stages>
 class DistanceFilter {
 public:
+    DistanceFilter() = default;
+
     /**
      * Creates a distance filter for the hyperbolic connection probability.
      *
@@ -27,14 +29,20 @@ public:
      *  The radius of the hyperbolic disc.
      * @param T
      *  The temperature of the graph.
+     * @param stages
+     *  The resolution of the filter (i.e. number of entries).
+     *  If 0, the filter only holds max_prob and must not be queried.
      */
-    DistanceFilter(double max_prob, double R, double T)
+    DistanceFilter(double max_prob, double R, double T, unsigned int stages)
     : max_connection_prob(max_prob)
     , stage_width(stages/max_prob)
     {
-        for(int i=1; i < stages; i++)
+        if (!stages)
+            return;
+
+        filter_stages.resize(stages+1);
+        for(auto i=1u; i < stages; i++)
             filter_stages[i] = cosh(invConnectionProb(max_connection_prob / stages * i, R, T));
-        // TODO maybe we should not save these values
         filter_stages[0] = std::numeric_limits<double>::infinity(); // at distance inf the conn prob is 0; cosh(inf)=inf
         filter_stages[stages] = 1.0; // at distance 0 the conn prob is largest; cosh(0)=1
     }
@@ -42,7 +50,7 @@ public:
     /// upper bound for cosh(dist) to have an edge probability lower than prob
     /// a vertex pair is surely disconnected if cosh(dist) is larger than the returned value
     double coshDistForProb_upperBound(double prob) const {
-        assert(prob < max_connection_prob);
+        assert(prob < max_connection_prob && !filter_stages.empty());
         const auto index = static_cast<int>(stage_width * prob);
         return filter_stages[index];
     }
@@ -50,13 +58,18 @@ public:
     /// lower bound for cosh(dist) to have an edge probability larger than prob
     /// a vertex pair is surely connected if cosh(dist) is smaller than the returned value
     double coshDistForProb_lowerBound(double prob) const {
-        assert(prob < max_connection_prob);
+        assert(prob < max_connection_prob && !filter_stages.empty());
         const auto index = static_cast<int>(std::ceil(stage_width * prob));
         return filter_stages[index];
     }
 
+    /// number of stages; 0 for a default constructed filter
+    unsigned int stages() const {
+        return filter_stages.empty() ? 0 : static_cast<unsigned int>(filter_stages.size() - 1);
+    }
+
 
-    const double max_connection_prob;     ///< range of the filter. See c'tor
+    double max_connection_prob = 0.0;     ///< range of the filter. See c'tor
 private:
 
     /// inverse of the edge probability function
@@ -65,8 +78,8 @@ private:
         return R + 2*T*std::log(1.0 / p - 1);
     }
 
-    std::array<double, stages+1> filter_stages; ///< pos i holds the cosh(distance) at which to points would have a connection prob of (i/stages)
-    const double stage_width;
+    double stage_width = 0.0;
+    std::vector<double> filter_stages; ///< pos i holds the cosh(distance) at which to points would have a connection prob of (i/stages)
 };
 
 
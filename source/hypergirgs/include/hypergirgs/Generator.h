@@ -4,24 +4,53 @@
 #include <vector>
 #include <random>
 #include <utility>
+#include <cstdint>
 
 #include <hypergirgs/hypergirgs_api.h>
+#include <hypergirgs/CSRGraph.h>
 
 
 namespace hypergirgs {
 
 using default_random_engine = std::mt19937_64;
 
-HYPERGIRGS_API double calculateRadius(int n, double alpha, double T, double deg);
-HYPERGIRGS_API double calculateRadiusLikeNetworKit(int n, double alpha, double T, double deg);
+HYPERGIRGS_API double calculateRadius(long long n, double alpha, double T, double deg);
+HYPERGIRGS_API double calculateRadiusLikeNetworKit(long long n, double alpha, double T, double deg);
 
-HYPERGIRGS_API std::vector<double> sampleRadii(int n, double alpha, double R, int seed, bool parallel = true);
-HYPERGIRGS_API std::vector<double> sampleAngles(int n, int seed, bool parallel = true);
+HYPERGIRGS_API std::vector<double> sampleRadii(long long n, double alpha, double R, int seed, bool parallel = true);
+HYPERGIRGS_API std::vector<double> sampleAngles(long long n, int seed, bool parallel = true);
 
 /// If both, radii and angles, are to be sampled prefer this function of sampleRadii() and sampleAngles() for performance and quality reasons.
-HYPERGIRGS_API std::pair<std::vector<double>, std::vector<double> > sampleRadiiAndAngles(int n, double alpha, double R, int seed, bool parallel = true);
+HYPERGIRGS_API std::pair<std::vector<double>, std::vector<double> > sampleRadiiAndAngles(long long n, double alpha, double R, int seed, bool parallel = true);
 
 
+/// The sampled edges only depend on the seed and not on the number of threads.
+/// The order of the edge list may differ between runs with multiple threads.
+/// @throw std::length_error if there are 2^31-1 or more nodes; use generateEdges64() instead
 HYPERGIRGS_API std::vector<std::pair<int, int> > generateEdges(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed = 0);
 
+/// Same as generateEdges() but with 64 bit node ids, i.e. for graphs with more than 2^31-1 nodes.
+HYPERGIRGS_API std::vector<std::pair<int64_t, int64_t> > generateEdges64(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed = 0);
+
+/// Samples the same graph as generateEdges() but returns it in compressed sparse row format without materializing an edge list.
+/// The edges are sampled twice, first to count the degrees and then to fill the neighbors (see CSRBuilder).
+/// If symmetric is false, each edge {u,v} is only stored in the neighbors of min(u,v) (upper triangle).
+/// @throw std::length_error if there are 2^31-1 or more nodes; use generateCSR64() instead
+HYPERGIRGS_API CSRGraph<int> generateCSR(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed = 0, bool symmetric = true);
+
+/// Same as generateCSR() but with 64 bit node ids.
+HYPERGIRGS_API CSRGraph<int64_t> generateCSR64(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed = 0, bool symmetric = true);
+
+/// Samples n points like sampleRadiiAndAngles() and the edges between them like generateEdges(), but the points
+/// are generated directly in the order of the HyperbolicTree, which saves the classification and the sort of the points.
+/// The points only depend on positionSeed (not on the number of threads), but differ from those of sampleRadiiAndAngles().
+/// If radii and angles are not null, they receive the n coordinates, e.g. to save them.
+/// @throw std::length_error if there are 2^31-1 or more nodes; use generatePositionsAndEdges64() instead
+HYPERGIRGS_API std::vector<std::pair<int, int> > generatePositionsAndEdges(long long n, double alpha, double T, double R, int positionSeed, int samplingSeed,
+                                                                          double* radii = nullptr, double* angles = nullptr);
+
+/// Same as generatePositionsAndEdges() but with 64 bit node ids.
+HYPERGIRGS_API std::vector<std::pair<int64_t, int64_t> > generatePositionsAndEdges64(long long n, double alpha, double T, double R, int positionSeed, int samplingSeed,
+                                                                                    double* radii = nullptr, double* angles = nullptr);
+
 } // namespace hypergirgs
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <cassert>
+
+#include <omp.h>
+
+
+namespace hypergirgs {
+
+/**
+ * @brief
+ *  Edge callback that counts the edges of each thread without storing them.
+ *  Each counter lives in its own cache line.
+ */
+class EdgeCounter {
+public:
+    explicit EdgeCounter(int max_threads = omp_get_max_threads())
+        : m_counts(max_threads)
+    {
+        for (auto& each : m_counts)
+            each.first = 0;
+    }
+
+    template <typename NodeId>
+    void operator()(NodeId, NodeId, int tid) {
+        assert(0 <= tid && tid < m_counts.size());
+        ++m_counts[tid].first;
+    }
+
+    uint64_t numEdges() const {
+        uint64_t result = 0;
+        for (auto& each : m_counts)
+            result += each.first;
+        return result;
+    }
+
+private:
+    std::vector<std::pair<
+            uint64_t,
+            uint64_t[7] /* avoid false sharing */
+    > > m_counts;
+};
+
+/**
+ * @brief
+ *  Edge callback that accumulates the degree sequence without storing the edges,
+ *  e.g. to validate parameters at full generation speed before a full run.
+ *  It can be passed wherever an EdgeCallback is expected (e.g. makeHyperbolicTree()).
+ *
+ *  All threads share one array of n degree counters that is updated with relaxed atomic increments,
+ *  so the memory is n counters independent of the number of threads.
+ *  finalize() builds per-thread degree histograms in parallel and merges them.
+ *
+ * @tparam NodeId
+ *  Type of the node indices (int or int64_t).
+ */
+template <typename NodeId = int>
+class GraphStatistics {
+public:
+    /// unsigned, as wide as NodeId
+    using degree_type = typename std::make_unsigned<NodeId>::type;
+
+    explicit GraphStatistics(size_t n)
+        : m_n(n)
+        , m_degrees(n, 0)
+    { }
+
+    void operator()(NodeId u, NodeId v, int) {
+        assert(0 <= u && static_cast<size_t>(u) < m_n);
+        assert(0 <= v && static_cast<size_t>(v) < m_n);
+        #pragma omp atomic
+        ++m_degrees[u];
+        #pragma omp atomic
+        ++m_degrees[v];
+    }
+
+    /// computes the histogram and the edge count; call once after the generation finished
+    void finalize() {
+        m_histogram.assign(1, 0);
+        uint64_t sum = 0;
+
+        #pragma omp parallel
+        {
+            std::vector<uint64_t> histogram;
+            uint64_t local_sum = 0;
+
+            #pragma omp for schedule(static)
+            for (long long i = 0; i < static_cast<long long>(m_n); ++i) {
+                const auto degree = m_degrees[i];
+                local_sum += degree;
+                if (degree >= histogram.size())
+                    histogram.resize(degree + 1, 0);
+                ++histogram[degree];
+            }
+
+            #pragma omp critical
+            {
+                sum += local_sum;
+                if (histogram.size() > m_histogram.size())
+                    m_histogram.resize(histogram.size(), 0);
+                for (size_t k = 0; k < histogram.size(); ++k)
+                    m_histogram[k] += histogram[k];
+            }
+        }
+
+        assert(sum % 2 == 0);
+        m_num_edges = sum / 2;
+    }
+
+    /// the following accessors are valid after finalize()
+    const std::vector<degree_type>& degrees() const { return m_degrees; }
+
+    /// histogram()[k] is the number of nodes with degree k; the last entry is non-zero unless n = 0
+    const std::vector<uint64_t>& histogram() const { return m_histogram; }
+
+    uint64_t numEdges() const { return m_num_edges; }
+
+    double averageDegree() const { return m_n ? 2.0 * m_num_edges / m_n : 0.0; }
+
+    uint64_t maxDegree() const { return m_histogram.size() - 1; }
+
+private:
+    const size_t m_n;
+
+    std::vector<degree_type> m_degrees;
+    std::vector<uint64_t> m_histogram;
+    uint64_t m_num_edges = 0;
+};
+
+} // namespace hypergirgs
@@ -5,9 +5,10 @@
 #include <random>
 #include <atomic>
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <cassert>
-#include <condition_variable>
-#include <mutex>
+#include <queue>
 
 #include <omp.h>
 
@@ -17,42 +18,152 @@
 #include <hypergirgs/Point.h>
 #include <hypergirgs/DistanceFilter.h>
 #include <hypergirgs/Generator.h>
+#include <hypergirgs/Random.h>
 
 
 namespace hypergirgs {
 
+/// A part of the sampling that runs in one piece on one thread (see HyperbolicTree::decompose())
 struct TaskDescription {
     unsigned int cellA;
     unsigned int cellB;
-    TaskDescription(unsigned int A, unsigned int B)
-        : cellA(A), cellB(B)
+    unsigned int level;
+    bool recurse; ///< if true, the whole recursion below the cell pair; otherwise only the samples of the cell pair itself
+    double cost;  ///< estimated number of point pairs to compare
+    int layer_pair; ///< if not negative, only the type 1 sample of this layer pair of the level (threshold model only)
+    TaskDescription(unsigned int A, unsigned int B, unsigned int level, bool recurse, double cost, int layer_pair = -1)
+        : cellA(A), cellB(B), level(level), recurse(recurse), cost(cost), layer_pair(layer_pair)
     {}
 };
 
 
-template <typename EdgeCallback>
+/**
+ * @brief
+ *  Samples the edges of a hyperbolic random graph for given radii and angles.
+ *
+ * @tparam EdgeCallback
+ *  Called as edgeCallback(u, v, threadId) for each sampled edge.
+ * @tparam Engine
+ *  Random engine with 64 bit outputs that can be constructed from a 64 bit key, e.g.
+ *  Xoshiro256PlusPlus, Philox4x32 or SplitMix64 (see Random.h) or std::mt19937_64.
+ * @tparam NodeId
+ *  Type of the node ids passed to the EdgeCallback (int or int64_t).
+ *  Use int64_t for graphs with 2^31-1 or more nodes; int keeps the points and prefix sums smaller.
+ */
+template <typename EdgeCallback, typename Engine = Xoshiro256PlusPlus, typename NodeId = int>
 class HyperbolicTree
 {
 public:
 
-    HyperbolicTree(const std::vector<double>& radii, const std::vector<double>& angles, double T, double R, EdgeCallback& edgeCallback, bool profile = false);
-
+    /**
+     * @param layer_height
+     *  Height of the radius layers; if not positive, it is chosen by RadiusLayer::autoLayerHeight().
+     */
+    HyperbolicTree(const std::vector<double>& radii, const std::vector<double>& angles, double T, double R, EdgeCallback& edgeCallback,
+                   bool profile = false, double layer_height = 0.0);
+
+    /**
+     * @brief
+     *  Samples n points (distributed like sampleRadiiAndAngles()) directly in the order of the tree
+     *  instead of classifying and sorting given radii and angles (see RadiusLayer::samplePartition()).
+     *
+     * @param positionSeed
+     *  Seed for the points; the points only depend on it and not on the number of threads. Negative for a random seed.
+     * @param radii, angles
+     *  Optional output of n entries each: the coordinates of node i are written to radii[i] and angles[i].
+     * @param layer_height
+     *  Height of the radius layers; if not positive, it is chosen by RadiusLayer::autoLayerHeight().
+     */
+    HyperbolicTree(long long n, double alpha, double T, double R, int positionSeed, EdgeCallback& edgeCallback,
+                   double* radii = nullptr, double* angles = nullptr, bool profile = false, double layer_height = 0.0);
+
+    /**
+     * @brief
+     *  Samples the edges and reports them to the EdgeCallback.
+     *
+     * @param seed
+     *  The seed for the edge sampling; negative for a random seed.
+     *  Each visited pair of cells uses its own random stream derived from the seed (see taskGenerator()),
+     *  so the graph only depends on the seed and not on the number of threads.
+     */
     void generate(int seed) const;
 
-protected:
-    /// Create a set of tasks to be executed in parallel; We'll skip all sampling steps during recursion (call visitCellPairSample!)
-    void visitCellPairCreateTasks(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int first_parallel_level,
-                                  std::vector<TaskDescription>& parallel_calls) const;
+    /**
+     * @brief
+     *  Splits the sampling into tasks for generate() with num_threads threads.
+     *  Starting with the whole recursion, the most expensive task (see estimateCost()) is split into the samples of its
+     *  cell pair and the recursions of its child pairs, until no task costs more than 1/(tasks_per_thread*num_threads)
+     *  of the total. Cheap parts of the recursion thus remain in a single task, while the skewed ones of the inner
+     *  radius layers are split deeply. In the threshold model, which draws no random numbers, the samples of an
+     *  expensive cell pair are further split into its layer pairs.
+     *
+     * @return
+     *  Tasks that cover all samples once, ordered by decreasing estimated cost (for LPT scheduling).
+     */
+    std::vector<TaskDescription> decompose(int num_threads) const;
 
-    /// Performs same recursion as visitCellPairCreateTasks, but samples for cells skipp by visitCellPairCreateTasks.
-    int visitCellPairSample(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int first_parallel_level,
-                                  int num_threads, int thread_shift, default_random_engine& gen) const;
+    /// Samples the edges of a task of decompose(); the edges only depend on the seed and not on the decomposition
+    void sampleTask(const TaskDescription& task, uint64_t seed) const;
 
-    /// Recursively sample cellA and cellB for level and higher
-    void visitCellPair(unsigned int cellA, unsigned int cellB, unsigned int level, default_random_engine& gen) const;
+    /// number of levels of the recursion
+    unsigned int levels() const { return m_levels; }
+
+    /// height of the radius layers
+    double layerHeight() const { return m_layer_height; }
+
+    /// number of point pairs decided via a DistanceFilter in the last generate(); only counted if profiling is enabled
+    long long filterChecks() const { return m_filter_checks; }
+
+    /// number of those pairs the filter could not decide, s.t. their connection probability was computed
+    long long filterFallbacks() const { return m_filter_fallbacks; }
+
+protected:
+    /// Determines the layer pairs of each level and the distance filters once the points are partitioned
+    void preprocessLayers();
 
-    void sampleTypeI(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, default_random_engine& gen) const;
-    void sampleTypeII(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, default_random_engine& gen) const;
+    /// Recursively sample cellA and cellB for level and higher
+    void visitCellPair(unsigned int cellA, unsigned int cellB, unsigned int level, uint64_t seed) const;
+
+    /// The samples of cellA and cellB themselves, i.e. type 1 for touching and type 2 for non-touching cells
+    void sampleCellPair(unsigned int cellA, unsigned int cellB, unsigned int level, uint64_t seed) const;
+
+    /**
+     * @brief
+     *  Estimates the number of point pairs that visitCellPair() (if recurse) or sampleCellPair() compares,
+     *  from the number of points of each radius layer in the cells (i.e. from the prefix sums in m_first_in_cell).
+     *  Points are assumed to be uniform in angle within a cell. For a type 2 sample only the expected number
+     *  of proposals counts (the whole pair if it falls back to type 1); those below touching cells are neglected.
+     */
+    double estimateCost(unsigned int cellA, unsigned int cellB, unsigned int level, bool recurse) const;
+
+    void sampleTypeI(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, Engine& gen) const;
+    void sampleTypeII(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, Engine& gen) const;
+
+    /**
+     * @brief
+     *  The position of the type 2 filter of layers i and j for cell pairs on level with cells_between (1 or 2) cells
+     *  between them (see AngleHelper::cellsBetween()). The filters are symmetric in i and j, so both share a slot.
+     *  Slots for level < 2 or level > partitioningBaseLevel() of the layers are unused.
+     */
+    size_t typeIIFilterSlot(unsigned int i, unsigned int j, unsigned int level, unsigned int cells_between) const;
+
+    /// the type 2 filter of typeIIFilterSlot(i, j, level, cells_between)
+    const DistanceFilter& typeIIFilter(unsigned int i, unsigned int j, unsigned int level, unsigned int cells_between) const;
+
+    /// adds the filter statistics of a sample to m_filter_checks and m_filter_fallbacks
+    void countFilterChecks(long long checks, long long fallbacks) const;
+
+    /**
+     * @brief
+     *  The random stream of all samples of the visit of cellA and cellB, i.e. of all their layer pairs.
+     *  Cell ids are unique across levels, so each visited cell pair gets its own stream,
+     *  no matter which thread executes it. One stream per cell pair rather than per layer pair
+     *  keeps the cost of keying the engines low.
+     *
+     * @return
+     *  A freshly keyed engine.
+     */
+    Engine taskGenerator(uint64_t seed, unsigned int cellA, unsigned int cellB) const;
 
     /// takes lower bound on radius for two layers
     unsigned int partitioningBaseLevel(double r1, double r2) const;
@@ -60,8 +171,6 @@ protected:
     /// 1.0 / connection probability with respect to hyperbolic distance
     double connectionProbRec(double dist) const;
 
-    std::vector<default_random_engine> initialize_prngs(size_t n, unsigned seed) const;
-
 protected:
     EdgeCallback& m_edgeCallback;
     const bool m_profile;
@@ -72,20 +181,40 @@ protected:
 
     const double m_T; ///< temperature
     const double m_R; ///< radius
+    double m_layer_height; ///< height of the radius layers
 
     unsigned int m_layers; ///< number of layers
     unsigned int m_levels; ///< number of levels
 
-    std::vector<Point>          m_points;        ///< points ordered by layer first and cell second
-    std::vector<unsigned int>   m_first_in_cell; ///< prefix sums into points array
-    std::vector<RadiusLayer>    m_radius_layers; ///< data structure to access the points
+    std::vector<Point<NodeId>>  m_points;        ///< points ordered by layer first and cell second
+    std::vector<NodeId>         m_first_in_cell; ///< prefix sums into points array
+    std::vector<RadiusLayer<NodeId>> m_radius_layers; ///< data structure to access the points
+
+    /// for T = 0 the points are sorted by angle within their cells (see RadiusLayer::sortCellsByAngle()); empty otherwise
+    std::vector<double> m_angles; ///< m_angles[k] is the angle of m_points[k]
+    /// for T = 0: coth and 1/sinh of the lower radius bound of each layer; they bound the angular window of type 1 checks
+    std::vector<std::pair<double, double>> m_window_terms;
+    /// for T = 0: rows of type 1 checks with at least this many points in B are restricted to the angular window;
+    /// shorter rows are cheaper to check pairwise than to search
+    constexpr static long long min_window_row = 64;
 
     std::vector<std::vector<std::pair<unsigned int, unsigned int> > > m_layer_pairs;
 
-    constexpr static size_t filter_size = 100;
-    DistanceFilter<filter_size> m_typeI_filter;
-    /// filter for layer ij on level l is in  m_typeII_filter[i*m_layers+j][l-2]; -2 because level 0 and 1 have no type 2 cell pairs
-    std::vector<std::vector<std::pair<DistanceFilter<filter_size>,DistanceFilter<filter_size>>>> m_typeII_filter;
+    /// decompose() aims for this many tasks per thread
+    constexpr static int tasks_per_thread = 16;
+
+    /// resolution of the distance filters (see DistanceFilter); the type 2 filters have min_typeII_filter_stages
+    /// for small T up to max_typeII_filter_stages for T close to 1 (see preprocessLayers())
+    constexpr static unsigned int typeI_filter_stages = 1024;
+    constexpr static unsigned int min_typeII_filter_stages = 32;
+    constexpr static unsigned int max_typeII_filter_stages = 256;
+
+    DistanceFilter m_typeI_filter;
+    std::vector<DistanceFilter> m_typeII_filters;      ///< the distinct type 2 filters; see typeIIFilter()
+    std::vector<unsigned int> m_typeII_filter_index; ///< index into m_typeII_filters for each typeIIFilterSlot()
+
+    mutable long long m_filter_checks{0};    ///< see filterChecks()
+    mutable long long m_filter_fallbacks{0}; ///< see filterFallbacks()
 
 #ifndef NDEBUG
     mutable long long m_type1_checks{0}; ///< number of node pairs per thread that are checked via a type 1 check
@@ -93,9 +222,19 @@ protected:
 #endif // NDEBUG
 };
 
-template <typename EdgeCallback>
-inline HyperbolicTree<EdgeCallback> makeHyperbolicTree(const std::vector<double>& radii, const std::vector<double>& angles, double T, double R, EdgeCallback& edgeCallback, bool profile = false) {
-    return {radii, angles, T, R, edgeCallback, profile};
+/// provide automatic type deduction for constructor; the engine and node id type may be chosen explicitly,
+/// e.g. makeHyperbolicTree<Philox4x32, int64_t>(...)
+template <typename Engine = Xoshiro256PlusPlus, typename NodeId = int, typename EdgeCallback>
+inline HyperbolicTree<EdgeCallback, Engine, NodeId> makeHyperbolicTree(const std::vector<double>& radii, const std::vector<double>& angles, double T, double R, EdgeCallback& edgeCallback,
+                                                                       bool profile = false, double layer_height = 0.0) {
+    return {radii, angles, T, R, edgeCallback, profile, layer_height};
+}
+
+template <typename Engine = Xoshiro256PlusPlus, typename NodeId = int, typename EdgeCallback>
+inline HyperbolicTree<EdgeCallback, Engine, NodeId> makeHyperbolicTree(long long n, double alpha, double T, double R, int positionSeed, EdgeCallback& edgeCallback,
+                                                                       double* radii = nullptr, double* angles = nullptr, bool profile = false,
+                                                                       double layer_height = 0.0) {
+    return {n, alpha, T, R, positionSeed, edgeCallback, radii, angles, profile, layer_height};
 }
 
 } // namespace hypergirgs
@@ -1,23 +1,78 @@
 
 namespace hypergirgs {
 
-template <typename EdgeCallback>
-HyperbolicTree<EdgeCallback>::HyperbolicTree(const std::vector<double> &radii, const std::vector<double> &angles,
-    double T, double R, EdgeCallback& edgeCallback, bool enable_profiling)
+template <typename EdgeCallback, typename Engine, typename NodeId>
+HyperbolicTree<EdgeCallback, Engine, NodeId>::HyperbolicTree(const std::vector<double> &radii, const std::vector<double> &angles,
+    double T, double R, EdgeCallback& edgeCallback, bool enable_profiling, double layer_height)
     : m_edgeCallback(edgeCallback)
     , m_profile(enable_profiling)
     , m_n(radii.size())
     , m_coshR(std::cosh(R))
     , m_T(T)
     , m_R(R)
-    , m_typeI_filter(1.0, R, T)
+    , m_typeI_filter(1.0, R, T, typeI_filter_stages)
 {
-    const auto layer_height = 1.0;
+    if (radii.size() >= static_cast<size_t>(std::numeric_limits<NodeId>::max()))
+        throw std::length_error("HyperbolicTree: too many nodes for the node id type; use 64 bit node ids");
+
+    if (layer_height <= 0.0) {
+        ScopedTimer timer("Choose layer height", enable_profiling);
+        layer_height = RadiusLayer<NodeId>::autoLayerHeight(radii, T, R);
+    }
+    m_layer_height = std::min(layer_height, R);
 
     // compute partition; hold ownership of radius_layers, points and prefix sums
-    m_radius_layers = RadiusLayer::buildPartition(radii, angles, R, layer_height, m_points, m_first_in_cell, enable_profiling);
+    m_radius_layers = RadiusLayer<NodeId>::buildPartition(radii, angles, R, m_layer_height, m_points, m_first_in_cell, enable_profiling);
+    preprocessLayers();
+}
+
+template <typename EdgeCallback, typename Engine, typename NodeId>
+HyperbolicTree<EdgeCallback, Engine, NodeId>::HyperbolicTree(long long n, double alpha, double T, double R, int positionSeed,
+    EdgeCallback& edgeCallback, double* radii, double* angles, bool enable_profiling, double layer_height)
+    : m_edgeCallback(edgeCallback)
+    , m_profile(enable_profiling)
+    , m_n(static_cast<size_t>(n))
+    , m_coshR(std::cosh(R))
+    , m_T(T)
+    , m_R(R)
+    , m_typeI_filter(1.0, R, T, typeI_filter_stages)
+{
+    if (static_cast<size_t>(n) >= static_cast<size_t>(std::numeric_limits<NodeId>::max()))
+        throw std::length_error("HyperbolicTree: too many nodes for the node id type; use 64 bit node ids");
+
+    if (layer_height <= 0.0) {
+        ScopedTimer timer("Choose layer height", enable_profiling);
+        layer_height = RadiusLayer<NodeId>::autoLayerHeight(n, alpha, T, R);
+    }
+    m_layer_height = std::min(layer_height, R);
+
+    const auto seed = positionSeed >= 0 ? static_cast<uint64_t>(positionSeed) : static_cast<uint64_t>(std::random_device{}());
+
+    // sample the points in their final order; hold ownership of radius_layers, points and prefix sums
+    m_radius_layers = RadiusLayer<NodeId>::samplePartition(n, alpha, R, m_layer_height, seed, m_points, m_first_in_cell,
+                                                           radii, angles, enable_profiling);
+    preprocessLayers();
+}
+
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::preprocessLayers() {
+    const auto enable_profiling = m_profile;
     m_layers = m_radius_layers.size();
     m_levels = m_radius_layers[0].m_target_level + 1;
+    if (enable_profiling)
+        std::cout << "Layer height: " << m_layer_height << ", layers: " << m_layers << ", levels: " << m_levels << "\n";
+
+    // for T = 0 we only check the points in B within the angular distance at which they may connect to a point in A
+    if (m_T <= std::numeric_limits<double_t>::epsilon()) {
+        RadiusLayer<NodeId>::sortCellsByAngle(m_points, m_first_in_cell, m_angles, enable_profiling);
+
+        m_window_terms.resize(m_layers);
+        for (auto j = 0u; j < m_layers; ++j) {
+            const auto r_min = m_radius_layers[j].m_r_min;
+            if (r_min > 0.0)
+                m_window_terms[j] = {std::cosh(r_min) / std::sinh(r_min), 1.0 / std::sinh(r_min)};
+        }
+    }
 
     // determine which layer pairs to sample in which level
     {
@@ -30,9 +85,22 @@ HyperbolicTree<EdgeCallback>::HyperbolicTree(const std::vector<double> &radii, c
 
     if(m_T) {
         ScopedTimer timer("Max Connection Prob.", enable_profiling);
-        m_typeII_filter.resize(m_layers*m_layers);
+
+        // Type 2 checks prevail for large T, while for small T there are few of them; so the resolution grows with T.
+        // Filters with max_connection_prob > 0.2 are never queried, as sampleTypeII() falls back to type 1 checks,
+        // and neither are those with so small a max_connection_prob that no pair is ever proposed
+        // (which are most of them for small T).
+        const auto stages = std::max(unsigned{min_typeII_filter_stages}, static_cast<unsigned int>(max_typeII_filter_stages * m_T));
+        const auto min_max_connection_prob = 1e-6 / (static_cast<double>(m_n) * m_n);
+        auto makeFilter = [&] (double max_connection_prob) -> DistanceFilter {
+            const auto used = min_max_connection_prob <= max_connection_prob && max_connection_prob <= 0.2;
+            return DistanceFilter(max_connection_prob, m_R, m_T, used ? stages : 0);
+        };
+
+        // The upper bound on the connection probability of a slot (see typeIIFilterSlot()); negative if unused
+        std::vector<double> max_connection_probs(m_layers * (m_layers + 1) / 2 * m_levels * 2, -1.0);
         for (auto i = 0u; i < m_layers; ++i)
-            for (auto j = 0u; j < m_layers; ++j) {
+            for (auto j = i; j < m_layers; ++j) {
                 const auto r1 = m_radius_layers[i].m_r_min;
                 const auto r2 = m_radius_layers[j].m_r_min;
                 const auto PBL = partitioningBaseLevel(r1, r2);
@@ -41,231 +109,254 @@ HyperbolicTree<EdgeCallback>::HyperbolicTree(const std::vector<double> &radii, c
                     // A,A+2 cell pairs
                     auto angular_distance_lower_bound = AngleHelper::dist(firstCell, firstCell+2, l);
                     auto dist_lower_bound = hyperbolicDistance(r1, 0, r2, angular_distance_lower_bound);
-                    auto max_connection_prob = 1.0 / connectionProbRec(dist_lower_bound);
+                    max_connection_probs[typeIIFilterSlot(i, j, l, 1)] = 1.0 / connectionProbRec(dist_lower_bound);
                     // A,A+3 cell pairs
                     angular_distance_lower_bound = AngleHelper::dist(firstCell, firstCell+3, l);
                     dist_lower_bound = hyperbolicDistance(r1, 0, r2, angular_distance_lower_bound);
-                    auto max_connection_prob2 = 1.0 / connectionProbRec(dist_lower_bound);
-                    m_typeII_filter[i*m_layers+j].push_back({{max_connection_prob, m_R, m_T}, {max_connection_prob2, m_R, m_T}});
+                    max_connection_probs[typeIIFilterSlot(i, j, l, 2)] = 1.0 / connectionProbRec(dist_lower_bound);
                 }
             }
+
+        // A filter only depends on the bound, so slots with equal bounds share it
+        auto distinct = max_connection_probs;
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        distinct.erase(distinct.begin(), std::lower_bound(distinct.begin(), distinct.end(), 0.0));
+
+        m_typeII_filters.resize(distinct.size());
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (long long k = 0; k < static_cast<long long>(distinct.size()); ++k)
+            m_typeII_filters[k] = makeFilter(distinct[k]);
+
+        m_typeII_filter_index.assign(max_connection_probs.size(), 0);
+        for (auto slot = 0u; slot < max_connection_probs.size(); ++slot)
+            if (max_connection_probs[slot] >= 0.0)
+                m_typeII_filter_index[slot] = static_cast<unsigned int>(
+                    std::lower_bound(distinct.begin(), distinct.end(), max_connection_probs[slot]) - distinct.begin());
+
+        if (enable_profiling)
+            std::cout << "Type 2 filters: " << m_typeII_filters.size() << " for " << max_connection_probs.size() << " slots\n";
     }
 }
 
-template <typename EdgeCallback>
-void HyperbolicTree<EdgeCallback>::generate(int seed) const {
+template <typename EdgeCallback, typename Engine, typename NodeId>
+size_t HyperbolicTree<EdgeCallback, Engine, NodeId>::typeIIFilterSlot(unsigned int i, unsigned int j, unsigned int level, unsigned int cells_between) const {
+    assert(1 <= cells_between && cells_between <= 2);
+    if (i > j)
+        std::swap(i, j);
+    const auto layer_pair = static_cast<size_t>(j) * (j + 1) / 2 + i;
+    return (layer_pair * m_levels + level) * 2 + cells_between - 1;
+}
+
+template <typename EdgeCallback, typename Engine, typename NodeId>
+const DistanceFilter& HyperbolicTree<EdgeCallback, Engine, NodeId>::typeIIFilter(unsigned int i, unsigned int j, unsigned int level, unsigned int cells_between) const {
+    return m_typeII_filters[m_typeII_filter_index[typeIIFilterSlot(i, j, level, cells_between)]];
+}
+
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::generate(int seed) const {
     #ifndef NDEBUG
     m_type1_checks = 0;
     m_type2_checks = 0;
     #endif
+    m_filter_checks = 0;
+    m_filter_fallbacks = 0;
+
+    // all random streams are derived from this seed; see taskGenerator
+    const auto edge_seed = seed >= 0 ? static_cast<uint64_t>(seed) : static_cast<uint64_t>(std::random_device{}());
 
     const auto num_threads = omp_get_max_threads();
     if(num_threads == 1) {
-        default_random_engine master_gen(seed >= 0 ? seed : std::random_device{}());
-        visitCellPair(0,0,0, master_gen);
-        assert(m_type1_checks + m_type2_checks == static_cast<long long>(m_n-1) * m_n);
-        return;
-    }
-
-    // We select the first parallel level, s.t. each thread gets on average two tasks
-    // with matching cellA==cellB. Those tasks are much more expensive than tasks with cellA != cellB.
-    const auto first_parallel_level = static_cast<int>(ceil(log2(2*num_threads)));
-    assert(first_parallel_level >= 2);
-    const auto num_tasks = (first_parallel_level == 2)
-        ? 10
-        : ((2 << first_parallel_level) + (3 << (first_parallel_level - 1)));
-
-    if (m_profile)
-        std::cout << "First Parallel Level: " << first_parallel_level << "\n";
-
-    // prepare seed_seq and initialize a gen per thread for initial sampling
-    auto gens = initialize_prngs(num_threads - 1 + num_tasks,
-        seed >= 0 ? seed : std::random_device{}());
-
-    // We have to implement our own task queue, here's the state:
-    std::vector<TaskDescription> tasks;
+        visitCellPair(0,0,0, edge_seed);
+    } else {
+        std::vector<TaskDescription> tasks;
+        {
+            ScopedTimer timer("Gen Tasks", m_profile);
+            tasks = decompose(num_threads);
+        }
 
-    // allow processing of pq
-    auto tasks_generated = false;
-    std::mutex mutex;
-    std::condition_variable cv;
+        if (m_profile)
+            std::cout << "Tasks: " << tasks.size() << ", most expensive: " << tasks.front().cost << " pairs\n";
 
-    std::atomic<unsigned int> next_task_to_process{0};
+        // The tasks are ordered by decreasing cost and each thread takes the next one as soon as it is idle (LPT).
+        // We're not using omp for to ensure that the first tasks are processed first.
+        std::atomic<size_t> next_task_to_process{0};
 
-    #pragma omp parallel num_threads(num_threads)
-    {
+        #pragma omp parallel num_threads(num_threads)
+        {
+            while(true) {
+                const auto i = next_task_to_process.fetch_add(1);
+                if (i >= tasks.size()) break;
 
-        const auto tid = omp_get_thread_num();
+                sampleTask(tasks[i], edge_seed);
+            }
+        }
+    }
 
-    // 1. Phase
-        // one thread will generate the task list
-        if (tid + 1 == num_threads && first_parallel_level < m_levels) {
-            ScopedTimer timer("Gen Tasks", m_profile);
-            tasks.reserve(num_tasks);
+    assert(m_type1_checks + m_type2_checks == static_cast<long long>(m_n-1) * m_n);
 
-            visitCellPairCreateTasks(0, 0, 0, first_parallel_level, tasks);
+    if (m_profile && m_T)
+        std::cout << "Filter fallbacks: " << m_filter_fallbacks << " of " << m_filter_checks << " checks\n";
+}
 
-            // In spirit of the LPT scheduling, we place expensive tasks to be processed first
-            std::partition(tasks.begin(), tasks.end(), [] (const TaskDescription& t) {
-                return t.cellA == t.cellB;});
+template <typename EdgeCallback, typename Engine, typename NodeId>
+std::vector<TaskDescription> HyperbolicTree<EdgeCallback, Engine, NodeId>::decompose(int num_threads) const {
+    auto cheaper = [] (const TaskDescription& a, const TaskDescription& b) {
+        return a.cost < b.cost;
+    };
+    std::priority_queue<TaskDescription, std::vector<TaskDescription>, decltype(cheaper)> pending(cheaper);
+    pending.emplace(0, 0, 0, true, estimateCost(0, 0, 0, true));
 
-            assert(num_tasks == tasks.size());
+    const auto max_cost = pending.top().cost / (tasks_per_thread * std::max(num_threads, 1));
+    const bool inThresholdMode = (m_T <= std::numeric_limits<double_t>::epsilon());
 
-            // inform consumers that tasks are ready
-            {
-                std::lock_guard<std::mutex> lock(mutex);
-                tasks_generated = true;
+    std::vector<TaskDescription> tasks;
+    while (!pending.empty() && pending.top().cost > max_cost) {
+        const auto task = pending.top();
+        pending.pop();
+
+        const auto touching = AngleHelper::touching(task.cellA, task.cellB, task.level);
+
+        // in the threshold model the type 1 samples of different layer pairs are independent
+        if (!task.recurse && touching && task.layer_pair < 0 && inThresholdMode) {
+            const auto& layer_pairs = m_layer_pairs[task.level];
+            for (auto k = 0u; k < layer_pairs.size(); ++k) {
+                const auto i = layer_pairs[k].first;
+                const auto j = layer_pairs[k].second;
+                if (task.cellA == task.cellB && i > j)
+                    continue;
+                const auto pairs = static_cast<double>(m_radius_layers[i].pointsInCell(task.cellA, task.level))
+                                 * static_cast<double>(m_radius_layers[j].pointsInCell(task.cellB, task.level));
+                tasks.emplace_back(task.cellA, task.cellB, task.level, false, pairs, static_cast<int>(k));
             }
-            cv.notify_all();
+            continue;
         }
 
-        // all others will sample the cells in the first levels of the recursion tree
-        if (tid + 1 < num_threads) {
-            visitCellPairSample(0, 0, 0, first_parallel_level, num_threads - 1, tid, gens[tid]);
-
-            // wait until tasks are ready
-            if (!tasks_generated) {
-                std::unique_lock<std::mutex> lock(mutex);
-                cv.wait(lock, [&] {return tasks_generated;});
-            }
+        // non-touching cells have no recursion, and the last level cannot be split
+        if (!task.recurse || !touching || task.level + 1 == m_levels) {
+            tasks.push_back(task);
+            continue;
         }
 
-    // 2. Phase
-        // we're not using omp for to ensure that the first tasks are processed first
-        while(true) {
-            const auto i = next_task_to_process.fetch_add(1);
-            if (i >= tasks.size()) break;
-
-            auto &task = tasks[i];
-            visitCellPair(task.cellA, task.cellB, first_parallel_level, gens[num_threads - 1 + i]);
-        }
+        // same split as in visitCellPair; the samples of the cell pair itself may be split again
+        pending.emplace(task.cellA, task.cellB, task.level, false, estimateCost(task.cellA, task.cellB, task.level, false));
+
+        const auto fA = AngleHelper::firstChild(task.cellA);
+        const auto fB = AngleHelper::firstChild(task.cellB);
+        const auto level = task.level + 1;
+        pending.emplace(fA + 0, fB + 0, level, true, estimateCost(fA + 0, fB + 0, level, true));
+        pending.emplace(fA + 0, fB + 1, level, true, estimateCost(fA + 0, fB + 1, level, true));
+        pending.emplace(fA + 1, fB + 1, level, true, estimateCost(fA + 1, fB + 1, level, true));
+        if (task.cellA != task.cellB)
+            pending.emplace(fA + 1, fB + 0, level, true, estimateCost(fA + 1, fB + 0, level, true));
     }
 
-    assert(m_type1_checks + m_type2_checks == static_cast<long long>(m_n-1) * m_n);
-}
-
-template <typename EdgeCallback>
-void HyperbolicTree<EdgeCallback>::visitCellPair(unsigned int cellA, unsigned int cellB, unsigned int level, default_random_engine& gen) const {
+    for (; !pending.empty(); pending.pop())
+        tasks.push_back(pending.top());
 
-    if(!AngleHelper::touching(cellA, cellB, level))
-    {   // not touching cells
-        #ifdef NDEBUG
-        if(!m_T) return; // I dont trust compiler optimization
-        #endif // NDEBUG
-        // sample all type 2 occurrences with this cell pair
-        for(auto l=level; l<m_levels; ++l)
-            for(auto& layer_pair : m_layer_pairs[l])
-                sampleTypeII(cellA, cellB, level, layer_pair.first, layer_pair.second, gen);
-        return;
-    }
+    std::stable_sort(tasks.begin(), tasks.end(), [] (const TaskDescription& a, const TaskDescription& b) {
+        return a.cost > b.cost;
+    });
 
-    // touching cells
+    return tasks;
+}
 
-    // sample all type 1 occurrences with this cell pair
-    for(auto& layer_pair : m_layer_pairs[level]){
-        if(cellA != cellB || layer_pair.first <= layer_pair.second)
-            sampleTypeI(cellA, cellB, level, layer_pair.first, layer_pair.second, gen);
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::sampleTask(const TaskDescription& task, uint64_t seed) const {
+    if (task.layer_pair >= 0) {
+        assert(m_T <= std::numeric_limits<double_t>::epsilon()); // no random numbers needed
+        Engine unused;
+        const auto& layer_pair = m_layer_pairs[task.level][task.layer_pair];
+        sampleTypeI(task.cellA, task.cellB, task.level, layer_pair.first, layer_pair.second, unused);
+    } else if (task.recurse) {
+        visitCellPair(task.cellA, task.cellB, task.level, seed);
+    } else {
+        sampleCellPair(task.cellA, task.cellB, task.level, seed);
     }
+}
 
-    // break if last level reached
-    if(level == m_levels-1) // if we are at the last level we don't need recursive calls
-        return;
+template <typename EdgeCallback, typename Engine, typename NodeId>
+double HyperbolicTree<EdgeCallback, Engine, NodeId>::estimateCost(unsigned int cellA, unsigned int cellB, unsigned int level, bool recurse) const {
+    const auto touching = AngleHelper::touching(cellA, cellB, level);
+    if (!touching && !m_T)
+        return 0.0; // type 2 samples are skipped in the threshold model
+
+    auto cost = 0.0;
+    for (auto l = level; l < m_levels; ++l) {
+        if (touching && l > level && !recurse)
+            break;
+
+        // the share of point pairs between cellA and cellB that are compared in level l, i.e. in touching
+        // descendants: 3 of d*d pairs per descendant of cellA if cellA == cellB, and 1 (2 around the full circle) otherwise
+        const auto d = std::ldexp(1.0, static_cast<int>(l - level));
+        const auto share = (cellA == cellB) ? std::min(1.0, 3.0 / d) : (level <= 1 ? 2.0 : 1.0) / (d * d);
+
+        for (auto& layer_pair : m_layer_pairs[l]) {
+            const auto i = layer_pair.first;
+            const auto j = layer_pair.second;
+            const auto pairs = static_cast<double>(m_radius_layers[i].pointsInCell(cellA, level))
+                             * static_cast<double>(m_radius_layers[j].pointsInCell(cellB, level));
+            if (touching) {
+                cost += pairs * share;
+            } else {
+                // the number of proposals of sampleTypeII
+                const auto& filter = typeIIFilter(i, j, level, AngleHelper::cellsBetween(cellA, cellB, level));
+                cost += pairs * (filter.max_connection_prob > 0.2 ? 1.0 : filter.max_connection_prob);
+            }
+        }
+    }
 
-    // recursive call for all children pairs (a,b) where a in A and b in B
-    // these will be type 1 if a and b touch or type 2 if they don't
-    auto fA = AngleHelper::firstChild(cellA);
-    auto fB = AngleHelper::firstChild(cellB);
-    visitCellPair(fA + 0, fB + 0, level+1, gen);
-    visitCellPair(fA + 0, fB + 1, level+1, gen);
-    visitCellPair(fA + 1, fB + 1, level+1, gen);
-    if(cellA != cellB)
-        visitCellPair(fA + 1, fB + 0, level+1, gen); // if A==B we already did this call 3 lines above
+    return cost;
 }
 
-template<typename EdgeCallback>
-void HyperbolicTree<EdgeCallback>::visitCellPairCreateTasks(unsigned int cellA, unsigned int cellB,
-                                                             unsigned int level,
-                                                             unsigned int first_parallel_level,
-                                                             std::vector<TaskDescription>& parallel_calls) const {
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::visitCellPair(unsigned int cellA, unsigned int cellB, unsigned int level, uint64_t seed) const {
+    sampleCellPair(cellA, cellB, level, seed);
 
-    if(!AngleHelper::touching(cellA, cellB, level))
+    // break if the cells do not touch or the last level is reached
+    if(!AngleHelper::touching(cellA, cellB, level) || level == m_levels-1)
         return;
 
     // recursive call for all children pairs (a,b) where a in A and b in B
     // these will be type 1 if a and b touch or type 2 if they don't
     auto fA = AngleHelper::firstChild(cellA);
     auto fB = AngleHelper::firstChild(cellB);
-
-    if(level+1 != first_parallel_level) {
-        visitCellPairCreateTasks(fA + 0, fB + 0, level + 1, first_parallel_level, parallel_calls);
-        visitCellPairCreateTasks(fA + 0, fB + 1, level + 1, first_parallel_level, parallel_calls);
-        visitCellPairCreateTasks(fA + 1, fB + 1, level + 1, first_parallel_level, parallel_calls);
-        if (cellA != cellB)
-            visitCellPairCreateTasks(fA + 1, fB + 0, level + 1, first_parallel_level, parallel_calls); // if A==B we already did this call 3 lines above
-    } else {
-        // store tasks
-        parallel_calls.emplace_back(fA+0, fB+0);
-        parallel_calls.emplace_back(fA+0, fB+1);
-        parallel_calls.emplace_back(fA+1, fB+1);
-        if (cellA != cellB)
-            parallel_calls.emplace_back(fA+1, fB);
-    }
+    visitCellPair(fA + 0, fB + 0, level+1, seed);
+    visitCellPair(fA + 0, fB + 1, level+1, seed);
+    visitCellPair(fA + 1, fB + 1, level+1, seed);
+    if(cellA != cellB)
+        visitCellPair(fA + 1, fB + 0, level+1, seed); // if A==B we already did this call 3 lines above
 }
 
-template<typename EdgeCallback>
-int HyperbolicTree<EdgeCallback>::visitCellPairSample(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int first_parallel_level,
-                                                                int num_threads, int thread_shift, default_random_engine& gen) const {
-
-    auto isMyTurn = [&] {
-        if (++thread_shift == num_threads) {
-            thread_shift = 0;
-            return true;
-        }
-        return false;
-    };
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::sampleCellPair(unsigned int cellA, unsigned int cellB, unsigned int level, uint64_t seed) const {
 
     if(!AngleHelper::touching(cellA, cellB, level))
     {   // not touching cells
+        #ifdef NDEBUG
+        if(!m_T) return; // I dont trust compiler optimization
+        #endif // NDEBUG
         // sample all type 2 occurrences with this cell pair
+        auto gen = taskGenerator(seed, cellA, cellB);
         for(auto l=level; l<m_levels; ++l)
             for(auto& layer_pair : m_layer_pairs[l])
-                if (isMyTurn())
-                    sampleTypeII(cellA, cellB, level, layer_pair.first, layer_pair.second, gen);
-
-        return thread_shift;
+                sampleTypeII(cellA, cellB, level, layer_pair.first, layer_pair.second, gen);
+        return;
     }
 
     // touching cells
 
     // sample all type 1 occurrences with this cell pair
+    auto gen = taskGenerator(seed, cellA, cellB);
     for(auto& layer_pair : m_layer_pairs[level]){
         if(cellA != cellB || layer_pair.first <= layer_pair.second)
-            if (isMyTurn())
-                sampleTypeI(cellA, cellB, level, layer_pair.first, layer_pair.second, gen);
-    }
-
-    // break if last level reached
-    if(level == m_levels-1) // if we are at the last level we don't need recursive calls
-        return thread_shift;
-
-    // recursive call for all children pairs (a,b) where a in A and b in B
-    // these will be type 1 if a and b touch or type 2 if they don't
-    if(level+1 != first_parallel_level) {
-        auto fA = AngleHelper::firstChild(cellA);
-        auto fB = AngleHelper::firstChild(cellB);
-        thread_shift = visitCellPairSample(fA + 0, fB + 0, level + 1, first_parallel_level, num_threads, thread_shift, gen);
-        thread_shift = visitCellPairSample(fA + 0, fB + 1, level + 1, first_parallel_level, num_threads, thread_shift, gen);
-        thread_shift = visitCellPairSample(fA + 1, fB + 1, level + 1, first_parallel_level, num_threads, thread_shift, gen);
-        if (cellA != cellB)
-            thread_shift = visitCellPairSample(fA + 1, fB + 0, level + 1, first_parallel_level, num_threads, thread_shift, gen);
+            sampleTypeI(cellA, cellB, level, layer_pair.first, layer_pair.second, gen);
     }
-
-    return thread_shift;
 }
 
 
-template <typename EdgeCallback>
-void HyperbolicTree<EdgeCallback>::sampleTypeI(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, default_random_engine& gen) const {
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::sampleTypeI(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, Engine& gen) const {
     auto rangeA = m_radius_layers[i].cellIterators(cellA, level);
     auto rangeB = m_radius_layers[j].cellIterators(cellB, level);
 
@@ -284,39 +375,94 @@ void HyperbolicTree<EdgeCallback>::sampleTypeI(unsigned int cellA, unsigned int
 
     const auto threadId = omp_get_thread_num();
 
-    int kA = 0;
-    std::uniform_real_distribution<> dist;
+    NodeId kA = 0;
+    FastUniformRealDistribution dist;
 
     // we evalutate T == 0 and store the result in a const LOCAL variable
     // to allow the compiler to assume it's constness and hence pull out the
     // if in the for loop
     const bool inThresholdMode = (m_T <= std::numeric_limits<double_t>::epsilon());
 
+    // number of pairs decided with m_typeI_filter, and of those the filter could not decide
+    long long filter_checks = 0;
+    long long filter_fallbacks = 0;
+
+    const auto endB = rangeB.second - m_points.data();
+
+    // Checks nodeInA against the points first, ..., last-1 for T = 0
+    auto connectRange = [&] (const Point<NodeId>& nodeInA, long long first, long long last) -> void {
+        for (; first < last; ++first) {
+            const auto& nodeInB = m_points[first];
+            if (nodeInA.isDistanceBelowR(nodeInB, m_coshR)) {
+                assert(hyperbolicDistance(nodeInA.radius, nodeInA.angle, nodeInB.radius, nodeInB.angle) < m_R);
+                m_edgeCallback(nodeInA.id, nodeInB.id, threadId);
+            }
+        }
+    };
+
+    // For T = 0 the points of B are sorted by angle (see preprocessLayers()). All points in layer j have a radius
+    // above its r_min, and a larger radius of B only shrinks the angular distance at which B may connect to A.
+    // So we bound the angular distance via r_min and search the window [phi - max_angle, phi + max_angle] in B.
+    const bool useAngularWindow = inThresholdMode && !m_angles.empty() && m_radius_layers[j].m_r_min > 0.0;
+    const auto window_terms = useAngularWindow ? m_window_terms[j] : std::pair<double, double>{};
+    const auto* angles = m_angles.data();
+
     for(auto pointerA = rangeA.first; pointerA != rangeA.second; ++kA, ++pointerA) {
+        const auto& nodeInA = *pointerA;
         auto offset = (cellA == cellB && i==j) ? kA+1 : 0;
-        for (auto pointerB = rangeB.first + offset; pointerB != rangeB.second; ++pointerB) {
-            const auto& nodeInA = *pointerA;
-            const auto& nodeInB = *pointerB;
 
-            // pointer magic gives same results
-            assert(nodeInA == m_radius_layers[i].kthPoint(cellA, level, kA));
-            assert(nodeInB == m_radius_layers[j].kthPoint(cellB, level, std::distance(rangeB.first, pointerB) ));
+        // pointer magic gives same results
+        assert(nodeInA == m_radius_layers[i].kthPoint(cellA, level, kA));
+        // points are in correct cells
+        assert(cellA - AngleHelper::firstCellOfLevel(level) == AngleHelper::cellForPoint(nodeInA.angle, level));
+        // points are in correct radius layer
+        assert(m_radius_layers[i].m_r_min < nodeInA.radius && nodeInA.radius <= m_radius_layers[i].m_r_max);
 
-            // points are in correct cells
-            assert(cellA - AngleHelper::firstCellOfLevel(level) == AngleHelper::cellForPoint(nodeInA.angle, level));
+#ifndef NDEBUG
+        for (auto pointerB = rangeB.first + offset; pointerB != rangeB.second; ++pointerB) {
+            const auto& nodeInB = *pointerB;
+            assert(nodeInB == m_radius_layers[j].kthPoint(cellB, level, std::distance(rangeB.first, pointerB)));
             assert(cellB - AngleHelper::firstCellOfLevel(level) == AngleHelper::cellForPoint(nodeInB.angle, level));
-
-            // points are in correct radius layer
-            assert(m_radius_layers[i].m_r_min < nodeInA.radius && nodeInA.radius <= m_radius_layers[i].m_r_max);
             assert(m_radius_layers[j].m_r_min < nodeInB.radius && nodeInB.radius <= m_radius_layers[j].m_r_max);
-
             assert(nodeInA != nodeInB);
-            if(inThresholdMode) {
-                if (nodeInA.isDistanceBelowR(nodeInB, m_coshR)) {
-                    assert(hyperbolicDistance(nodeInA.radius, nodeInA.angle, nodeInB.radius, nodeInB.angle) < m_R);
-                    m_edgeCallback(nodeInA.id, nodeInB.id, threadId);
-                }
-            } else {
+        }
+#endif // NDEBUG
+
+        auto firstB = (rangeB.first + offset) - m_points.data();
+        if(inThresholdMode) {
+            if (!useAngularWindow || endB - firstB < min_window_row) {
+                connectRange(nodeInA, firstB, endB);
+                continue;
+            }
+
+            // cos of the largest angular distance at which a point in B may connect; the margin is far
+            // above the rounding errors of this bound and of isDistanceBelowR, so no edge is missed
+            const auto cos_bound = nodeInA.coth_r * window_terms.first - m_coshR * nodeInA.invsinh_r * window_terms.second;
+            const auto margin = 1e-9 * (1.0 + std::abs(nodeInA.coth_r * window_terms.first)
+                                            + m_coshR * nodeInA.invsinh_r * window_terms.second);
+            const auto max_angle = (cos_bound - margin <= -1.0) ? PI : std::acos(std::min(1.0, cos_bound - margin)) + 1e-9;
+            if (max_angle >= PI) {
+                connectRange(nodeInA, firstB, endB);
+                continue;
+            }
+
+            auto connectWindow = [&] (double from, double to) -> void {
+                const auto first = std::lower_bound(angles + firstB, angles + endB, from) - angles;
+                const auto last = std::upper_bound(angles + first, angles + endB, to) - angles;
+                connectRange(nodeInA, first, last);
+            };
+
+            // the windows are disjoint as max_angle < pi; the last two cover the wrap-around at 0
+            const auto phi = angles[pointerA - m_points.data()];
+            connectWindow(phi - max_angle, phi + max_angle);
+            if (phi - max_angle < 0.0)
+                connectWindow(phi - max_angle + 2*PI, 2*PI);
+            if (phi + max_angle > 2*PI)
+                connectWindow(0.0, phi + max_angle - 2*PI);
+        } else {
+            filter_checks += endB - firstB;
+            for (; firstB < endB; ++firstB) {
+                const auto& nodeInB = m_points[firstB];
                 const auto rnd = dist(gen);
                 const auto real_dist_cosh = nodeInA.hyperbolicDistanceCosh(nodeInB);
 
@@ -334,16 +480,20 @@ void HyperbolicTree<EdgeCallback>::sampleTypeI(unsigned int cellA, unsigned int
                 }
 
                 // rnd is very close to the prob at which we connect this pair
+                ++filter_fallbacks;
                 if(rnd * connectionProbRec(std::acosh(real_dist_cosh)) < 1.0) {
                     m_edgeCallback(nodeInA.id, nodeInB.id, threadId);
                 }
             }
         }
     }
+
+    if (m_profile && filter_checks)
+        countFilterChecks(filter_checks, filter_fallbacks);
 }
 
-template <typename EdgeCallback>
-void HyperbolicTree<EdgeCallback>::sampleTypeII(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, default_random_engine& gen) const {
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::sampleTypeII(unsigned int cellA, unsigned int cellB, unsigned int level, unsigned int i, unsigned int j, Engine& gen) const {
 
     const auto sizeV_i_A = static_cast<long long>(m_radius_layers[i].pointsInCell(cellA, level));
     const auto sizeV_j_B = static_cast<long long>(m_radius_layers[j].pointsInCell(cellB, level));
@@ -356,9 +506,8 @@ void HyperbolicTree<EdgeCallback>::sampleTypeII(unsigned int cellA, unsigned int
     if (m_T == 0 || sizeV_i_A == 0 || sizeV_j_B == 0)
         return;
 
-    const auto& filters = m_typeII_filter[i*m_layers+j][level-2];
     assert(AngleHelper::cellsBetween(cellA, cellB, level) == 1 || AngleHelper::cellsBetween(cellA, cellB, level) == 2);
-    const auto& filter = (AngleHelper::cellsBetween(cellA, cellB, level) == 1 ? filters.first : filters.second);
+    const auto& filter = typeIIFilter(i, j, level, AngleHelper::cellsBetween(cellA, cellB, level));
     const auto max_connection_prob = filter.max_connection_prob;
 
     // skipping over points is actually quite expensive as it messes up
@@ -373,9 +522,9 @@ void HyperbolicTree<EdgeCallback>::sampleTypeII(unsigned int cellA, unsigned int
     }
 
 #ifndef NDEBUG
-    // get upper bound for probability
-    auto r_boundA = m_radius_layers[i].m_r_min;
-    auto r_boundB = m_radius_layers[j].m_r_min;
+    // get upper bound for probability; with the layers ordered as in preprocessLayers(), since i and j share the filter
+    auto r_boundA = m_radius_layers[std::min(i, j)].m_r_min;
+    auto r_boundB = m_radius_layers[std::max(i, j)].m_r_min;
     auto angular_distance_lower_bound = AngleHelper::dist(cellA, cellB, level);
     auto dist_lower_bound = hyperbolicDistance(r_boundA, 0, r_boundB, angular_distance_lower_bound);
     auto max_connection_prob_check = 1.0 / connectionProbRec(dist_lower_bound);
@@ -391,12 +540,15 @@ void HyperbolicTree<EdgeCallback>::sampleTypeII(unsigned int cellA, unsigned int
 
     // init geometric distribution
     const auto threadId = omp_get_thread_num();
-    auto geo = std::geometric_distribution<unsigned long long>(max_connection_prob);
-    std::uniform_real_distribution<> dist(0.0, max_connection_prob);
+    auto geo = FastGeometricDistribution(max_connection_prob);
+    FastUniformRealDistribution dist(0.0, max_connection_prob);
 
     const auto* pointsA = &m_radius_layers[i].kthPoint(cellA, level, 0);
     const auto* pointsB = &m_radius_layers[j].kthPoint(cellB, level, 0);
 
+    long long filter_checks = 0;
+    long long filter_fallbacks = 0;
+
     for (auto r = geo(gen); r < num_pairs; r += 1 + geo(gen)) {
         // determine the r-th pair
         const auto& nodeInA = pointsA[r%sizeV_i_A];
@@ -414,6 +566,7 @@ void HyperbolicTree<EdgeCallback>::sampleTypeII(unsigned int cellA, unsigned int
         assert(m_radius_layers[j].m_r_min < nodeInB.radius && nodeInB.radius <= m_radius_layers[j].m_r_max);
 
         const auto rnd = dist(gen);
+        ++filter_checks;
 
         // get actual connection probability
         const auto real_dist_cosh = nodeInA.hyperbolicDistanceCosh(nodeInB);
@@ -436,47 +589,38 @@ void HyperbolicTree<EdgeCallback>::sampleTypeII(unsigned int cellA, unsigned int
         }
 
         // rnd is very close to the prob at which we connect this pair
+        ++filter_fallbacks;
         if(rnd * connectionProbRec(std::acosh(real_dist_cosh)) < 1.0) {
             m_edgeCallback(nodeInA.id, nodeInB.id, threadId);
         }
     }
-}
 
+    if (m_profile && filter_checks)
+        countFilterChecks(filter_checks, filter_fallbacks);
+}
 
-template <typename EdgeCallback>
-std::vector<default_random_engine> HyperbolicTree<EdgeCallback>::initialize_prngs(size_t n, unsigned seed) const {
-    std::vector<default_random_engine> gens;
-
-    // we need a generator for each tasks and also for each but one threads
-    constexpr auto state_size = default_random_engine::state_size;
-
-    // get high quality seed values from one PRNG
-    std::vector<uint32_t> seeds(n * state_size);
-    {
-        default_random_engine master_gen(seed);
-        std::uniform_int_distribution<std::uint32_t> dist;
-        std::generate(seeds.begin(), seeds.end(), [&] {return dist(master_gen);});
-    }
+template <typename EdgeCallback, typename Engine, typename NodeId>
+void HyperbolicTree<EdgeCallback, Engine, NodeId>::countFilterChecks(long long checks, long long fallbacks) const {
+    #pragma omp atomic
+    m_filter_checks += checks;
+    #pragma omp atomic
+    m_filter_fallbacks += fallbacks;
+}
 
-    // use a seed_seq to initialize all prngs
-    gens.reserve(n);
-    for(int i=0; i < n; ++i) {
-        auto begin = std::next(seeds.begin(), i * state_size);
-        auto end = std::next(begin, state_size);
-        std::seed_seq ss(begin, end);
-        gens.emplace_back(ss);
-    }
 
-    return gens;
+template <typename EdgeCallback, typename Engine, typename NodeId>
+Engine HyperbolicTree<EdgeCallback, Engine, NodeId>::taskGenerator(uint64_t seed, unsigned int cellA, unsigned int cellB) const {
+    const auto cells = (static_cast<uint64_t>(cellA) << 32) | cellB;
+    return Engine{streamKey(seed, cells)};
 }
 
-template <typename EdgeCallback>
-unsigned int HyperbolicTree<EdgeCallback>::partitioningBaseLevel(double r1, double r2) const {
-    return RadiusLayer::partitioningBaseLevel(r1, r2, m_R);
+template <typename EdgeCallback, typename Engine, typename NodeId>
+unsigned int HyperbolicTree<EdgeCallback, Engine, NodeId>::partitioningBaseLevel(double r1, double r2) const {
+    return RadiusLayer<NodeId>::partitioningBaseLevel(r1, r2, m_R);
 }
 
-template<typename EdgeCallback>
-double HyperbolicTree<EdgeCallback>::connectionProbRec(double dist) const {
+template<typename EdgeCallback, typename Engine, typename NodeId>
+double HyperbolicTree<EdgeCallback, Engine, NodeId>::connectionProbRec(double dist) const {
     return 1.0 + std::exp(0.5/m_T*(dist-m_R));
 }
 
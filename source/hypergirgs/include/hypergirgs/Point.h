@@ -22,9 +22,17 @@ static double hyperbolicDistance(double r1, double phi1, double r2, double phi2)
     return acosh(std::max(1., cosh(r1 - r2) + (1. - cos(phi1 - phi2)) * sinh(r1) * sinh(r2)));
 }
 
+/**
+ * @brief
+ *  A node with precomputed terms for fast distance computations.
+ *
+ * @tparam NodeId
+ *  Type of the node id (int or int64_t).
+ */
+template <typename NodeId = int>
 struct Point {
     Point() {}; // prevent initialization of members
-    Point(const int id, const double radius, const double angle, int cell_id = 0) :
+    Point(const NodeId id, const double radius, const double angle, int cell_id = 0) :
           id{id}
         , cell_id{cell_id}
         , invsinh_r{1.0 / std::sinh(radius)}
@@ -41,6 +49,27 @@ struct Point {
         assert(0 <= id);
     }
 
+    /// Same as above, but with the terms computed in batches by batch_math::pointTerms()
+    Point(const NodeId id, const double radius, const double angle, int cell_id,
+          double invsinh_r, double coth_r, double cos_phi, double sin_phi) :
+          id{id}
+        , cell_id{cell_id}
+        , invsinh_r{invsinh_r}
+        , coth_r{coth_r}
+        , cos_phi{cos_phi}
+        , sin_phi{sin_phi}
+#ifdef POINT_WITH_ORIGINAL
+        , radius{radius}
+        , angle{angle}
+#endif // POINT_WITH_ORIGINAL
+    {
+        assert(0 <= angle && angle < 2*3.14159265358979323846);
+        assert(0 <= radius);
+        assert(0 <= id);
+        (void)radius;
+        (void)angle;
+    }
+
     /// Check whether distance between this point and point pt is below the threshold R
     /// without using trigonometric functions. (Useful in the threshold model)
     /// @warning Pass cosh(R) rather than R as second parameter!
@@ -75,7 +104,7 @@ struct Point {
         return id != o.id;
     }
 
-    int    id;        ///< node id
+    NodeId id;        ///< node id
     int    cell_id;   ///< id of cell node will stored
 
     double invsinh_r; ///< = 1.0 / sinh(radius)
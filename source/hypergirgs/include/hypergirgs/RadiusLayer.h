@@ -2,6 +2,8 @@
 #pragma once
 
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <vector>
 #include <utility>
 
@@ -14,16 +16,25 @@
 namespace hypergirgs {
 
 
-class HYPERGIRGS_API RadiusLayer {
+/**
+ * @brief
+ *  Provides access to the points of a radius layer that lie in a cell (see girgs::WeightLayer).
+ *
+ * @tparam NodeId
+ *  Type of the node ids (int or int64_t); also used for the prefix sums into the point array.
+ *  The library contains both instantiations.
+ */
+template <typename NodeId = int>
+class RadiusLayer {
 public:
 
 	RadiusLayer() = delete;
 
 	RadiusLayer(double r_min, double r_max, unsigned int targetLevel,
-                const Point* base,
-                const unsigned int* prefix_sum);
+                const Point<NodeId>* base,
+                const NodeId* prefix_sum);
 
-    int pointsInCell(unsigned int cell, unsigned int level) const {
+    NodeId pointsInCell(unsigned int cell, unsigned int level) const {
         auto cellBoundaries = levelledCell(cell, level);
         assert(cellBoundaries.first  + AngleHelper::firstCellOfLevel(level) < AngleHelper::firstCellOfLevel(m_target_level+1));
         assert(cellBoundaries.second + AngleHelper::firstCellOfLevel(level) < AngleHelper::firstCellOfLevel(m_target_level+1));
@@ -31,12 +42,12 @@ public:
         return m_prefix_sums[cellBoundaries.second+1] - m_prefix_sums[cellBoundaries.first];
     }
 
-    const Point& kthPoint(unsigned int cell, unsigned int level, int k) const {
+    const Point<NodeId>& kthPoint(unsigned int cell, unsigned int level, NodeId k) const {
         auto cellBoundaries = levelledCell(cell, level);
         return m_base[m_prefix_sums[cellBoundaries.first] + k];
     }
 
-    std::pair<const Point*, const Point*> cellIterators(unsigned int cell, unsigned int level) const {
+    std::pair<const Point<NodeId>*, const Point<NodeId>*> cellIterators(unsigned int cell, unsigned int level) const {
         auto cellBoundaries = levelledCell(cell, level);
         const auto begin_end = std::make_pair(
                 m_base + m_prefix_sums[cellBoundaries.first],
@@ -49,9 +60,65 @@ public:
     static std::vector<RadiusLayer>
     buildPartition(const std::vector<double>& radii, const std::vector<double>& angles,
                    const double R, const double layer_height,
-                   std::vector<Point>& points, std::vector<unsigned int>& first_in_cell, // output parameter
+                   std::vector<Point<NodeId>>& points, std::vector<NodeId>& first_in_cell, // output parameter
                    bool enable_profiling);
 
+    /**
+     * @brief
+     *  Same result as buildPartition() for radii and angles sampled like sampleRadiiAndAngles(), but the points are
+     *  generated in their final order, i.e. they are neither classified nor sorted.
+     *  A single counting sort pass assigns the ids to random coarse cells (buckets) of the radius layers
+     *  with the right probabilities. Within a bucket (which fits into the cache) each point draws its cell of the
+     *  target level and is sorted by it. Then radius and angle are drawn within the cell and the point is built.
+     *  The result only depends on the seed and not on the number of threads.
+     *
+     * @param radii
+     *  Optional output: the radius of node i is written to radii[i].
+     * @param angles
+     *  Optional output: the angle of node i is written to angles[i].
+     */
+    static std::vector<RadiusLayer>
+    samplePartition(long long n, double alpha, const double R, const double layer_height, uint64_t seed,
+                    std::vector<Point<NodeId>>& points, std::vector<NodeId>& first_in_cell, // output parameter
+                    double* radii, double* angles, // optional output parameter
+                    bool enable_profiling);
+
+    /**
+     * @brief
+     *  Sorts the points of each cell by angle, s.t. the points of a cell pair at any level are sorted by angle
+     *  (except at the wrap-around from 2*pi to 0). For T = 0, HyperbolicTree then only checks the points within
+     *  the angular distance at which a connection is possible.
+     *  Points do not store their angle in release builds, so it is recovered from cos_phi and sin_phi.
+     *
+     * @param angles
+     *  Output: angles[k] is the recovered angle of points[k] (after sorting) in [0, 2*pi].
+     */
+    static void sortCellsByAngle(std::vector<Point<NodeId>>& points, const std::vector<NodeId>& first_in_cell,
+                                 std::vector<double>& angles, bool enable_profiling);
+
+    /**
+     * @brief
+     *  Chooses the height of the radius layers for buildPartition() and samplePartition().
+     *  Thin layers bound the radii of their points tightly, but create many layer pairs and cells to visit;
+     *  thick layers loosen the bounds on the distances, s.t. more pairs are checked and proposed by HyperbolicTree.
+     *  The height (from 0.5 to 4) minimizes a cost model of HyperbolicTree for the expected number of points per layer.
+     *
+     * @param alpha
+     *  The dispersion of the radii (see sampleRadii()).
+     * @return
+     *  The layer height; at most R.
+     */
+    static double autoLayerHeight(long long n, double alpha, double T, double R);
+
+    /// autoLayerHeight() for given radii; alpha is estimated from them
+    static double autoLayerHeight(const std::vector<double>& radii, double T, double R);
+
+    /// the angle of a point in [0, 2*pi] recovered from its precomputed terms
+    static double angleOf(const Point<NodeId>& point) noexcept {
+        const auto angle = std::atan2(point.sin_phi, point.cos_phi);
+        return angle < 0.0 ? angle + 2.0*PI : angle;
+    }
+
 
     // takes lower bound on radius for two layers
     static unsigned int partitioningBaseLevel(double r1, double r2, double R) noexcept {
@@ -92,9 +159,13 @@ public:
     const unsigned int m_target_level;  ///< insertion level for this radius layer
 
 protected:
-    const Point* m_base;                ///< sorted array of all points
-    const unsigned int* m_prefix_sums;  ///< for each cell c in target level: sum of points in m_base before first node in c
+    const Point<NodeId>* m_base;        ///< sorted array of all points
+    const NodeId* m_prefix_sums;        ///< for each cell c in target level: sum of points in m_base before first node in c
 
 };
 
+// the constructor and buildPartition are compiled into the library for these node id types
+extern template class HYPERGIRGS_API RadiusLayer<int>;
+extern template class HYPERGIRGS_API RadiusLayer<int64_t>;
+
 } // namespace hypergirgs
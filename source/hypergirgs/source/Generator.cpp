@@ -4,17 +4,17 @@
 #include <random>
 #include <fstream>
 #include <cmath>
-#include <mutex>
 
 #include <omp.h>
 
+#include <hypergirgs/EdgeBlocks.h>
 #include <hypergirgs/HyperbolicTree.h>
 
 
 namespace hypergirgs {
 
 
-double calculateRadius(int n, double alpha, double T, double deg) {
+double calculateRadius(long long n, double alpha, double T, double deg) {
     return 2 * log(n * 2 * alpha * alpha * (T == 0 ? 1 / PI : T / sin(PI * T)) /
                    (deg * (alpha - 0.5) * (alpha - 0.5)));
 }
@@ -75,13 +75,13 @@ static double getTargetRadius(double n, double m, double alpha=1, double T=0, do
 }
 ////////////////////////////////// END NETWORKIT COPY ////////////////////
 
-double calculateRadiusLikeNetworKit(int n, double alpha, double T, double deg) {
+double calculateRadiusLikeNetworKit(long long n, double alpha, double T, double deg) {
     return getTargetRadius(n, 0.5*deg*n, alpha, T);
 }
 
 template <bool Radii, bool Angles>
 static std::pair<std::vector<double>, std::vector<double>> sampleRadiiAndAnglesHelper(
-    const int n, const double alpha, const double R, const int seed, const bool parallel
+    const long long n, const double alpha, const double R, const int seed, const bool parallel
 ) {
     static_assert(Radii || Angles, "At least one output is required");
 
@@ -89,7 +89,7 @@ static std::pair<std::vector<double>, std::vector<double>> sampleRadiiAndAnglesH
     std::vector<double> angles(n * Angles);
 
     constexpr auto kMinChunkSize = 10000;
-    const auto threads = parallel ? std::min<int>(omp_get_max_threads(), (n + kMinChunkSize - 1) / kMinChunkSize) : 1;
+    const auto threads = parallel ? static_cast<int>(std::min<long long>(omp_get_max_threads(), (n + kMinChunkSize - 1) / kMinChunkSize)) : 1;
 
     const auto invalpha = 1.0 / alpha;
     #pragma omp parallel num_threads(threads)
@@ -100,11 +100,11 @@ static std::pair<std::vector<double>, std::vector<double>> sampleRadiiAndAnglesH
 
         // warm-up generator
         constexpr int kMinWarmup = 1000;
-        for (int i = 0; i < std::max<int>(n / threads / 5, kMinWarmup); ++i)
+        for (long long i = 0; i < std::max<long long>(n / threads / 5, kMinWarmup); ++i)
             gen();
 
         #pragma omp for schedule(static)
-        for (int i = 0; i < n; ++i) {
+        for (long long i = 0; i < n; ++i) {
             if (Angles)
                 angles[i] = adist(gen);
 
@@ -117,57 +117,86 @@ static std::pair<std::vector<double>, std::vector<double>> sampleRadiiAndAnglesH
 }
 
 
-std::vector<double> sampleRadii(int n, double alpha, double R, int seed, bool parallel) {
+std::vector<double> sampleRadii(long long n, double alpha, double R, int seed, bool parallel) {
     return sampleRadiiAndAnglesHelper<true, false>(n, alpha, R, seed, parallel).first;
 }
 
-std::vector<double> sampleAngles(int n, int seed, bool parallel) {
+std::vector<double> sampleAngles(long long n, int seed, bool parallel) {
     return sampleRadiiAndAnglesHelper<false, true>(n, /*unused*/1.0, /*unused*/10.0, seed, parallel).second;
 
 }
 
-std::pair<std::vector<double>, std::vector<double>> sampleRadiiAndAngles(int n, double alpha, double R, int seed, bool parallel) {
+std::pair<std::vector<double>, std::vector<double>> sampleRadiiAndAngles(long long n, double alpha, double R, int seed, bool parallel) {
     return sampleRadiiAndAnglesHelper<true, true>(n, alpha, R, seed, parallel);
 }
 
+template <typename NodeId>
+static std::vector<std::pair<NodeId, NodeId> > generateEdgeList(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed) {
+
+    EdgeBlocks<NodeId> blocks;
+    auto generator = hypergirgs::makeHyperbolicTree<Xoshiro256PlusPlus, NodeId>(radii, angles, T, R, blocks);
+    generator.generate(seed);
+    return blocks.merge();
+}
+
 std::vector<std::pair<int, int> > generateEdges(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed) {
+    return generateEdgeList<int>(radii, angles, T, R, seed);
+}
 
-    using edge_vector = std::vector<std::pair<int, int>>;
-    edge_vector result;
+std::vector<std::pair<int64_t, int64_t> > generateEdges64(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed) {
+    return generateEdgeList<int64_t>(radii, angles, T, R, seed);
+}
 
-    std::vector<std::pair<
-            edge_vector,
-            uint64_t[31] /* avoid false sharing */
-    > > local_edges(omp_get_max_threads());
+template <typename NodeId>
+static CSRGraph<NodeId> generateCSRImpl(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed, bool symmetric) {
+    // both passes have to sample the same graph
+    if (seed < 0)
+        seed = static_cast<int>(std::random_device{}() >> 1);
+
+    CSRBuilder<NodeId> builder(radii.size(), symmetric);
+    auto filling = false;
+    auto addEdge = [&builder, &filling] (NodeId u, NodeId v, int) {
+        if (filling)
+            builder.add(u, v);
+        else
+            builder.count(u, v);
+    };
 
-    constexpr auto block_size = size_t{1} << 20;
+    // the tree is built once and sampled twice
+    auto generator = hypergirgs::makeHyperbolicTree<Xoshiro256PlusPlus, NodeId>(radii, angles, T, R, addEdge);
+    generator.generate(seed);
+    builder.allocate();
+    filling = true;
+    generator.generate(seed);
 
-    for(auto& v : local_edges)
-        v.first.reserve(block_size);
+    return builder.finish();
+}
 
-    std::mutex m;
-    auto flush = [&] (const edge_vector& local) {
-        std::lock_guard<std::mutex> lock(m);
-        result.insert(result.end(), local.cbegin(), local.cend());
-    };
+CSRGraph<int> generateCSR(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed, bool symmetric) {
+    return generateCSRImpl<int>(radii, angles, T, R, seed, symmetric);
+}
 
-    auto addEdge = [&](int u, int v, int tid) {
-        auto& local = local_edges[tid].first;
-        local.emplace_back(u,v);
-        if (local.size() == block_size) {
-            flush(local);
-            local.clear();
-            local.reserve(block_size); // just in case
-        }
-    };
+CSRGraph<int64_t> generateCSR64(std::vector<double>& radii, std::vector<double>& angles, double T, double R, int seed, bool symmetric) {
+    return generateCSRImpl<int64_t>(radii, angles, T, R, seed, symmetric);
+}
 
-    auto generator = hypergirgs::makeHyperbolicTree(radii, angles, T, R, addEdge);
-    generator.generate(seed);
+template <typename NodeId>
+static std::vector<std::pair<NodeId, NodeId> > generatePositionsAndEdgesImpl(long long n, double alpha, double T, double R, int positionSeed, int samplingSeed,
+                                                                            double* radii, double* angles) {
+    EdgeBlocks<NodeId> blocks;
+    auto generator = hypergirgs::makeHyperbolicTree<Xoshiro256PlusPlus, NodeId>(n, alpha, T, R, positionSeed, blocks, radii, angles);
+    generator.generate(samplingSeed);
+    return blocks.merge();
+}
 
-    for(const auto& v : local_edges)
-        flush(v.first);
+std::vector<std::pair<int, int> > generatePositionsAndEdges(long long n, double alpha, double T, double R, int positionSeed, int samplingSeed,
+                                                            double* radii, double* angles) {
+    return generatePositionsAndEdgesImpl<int>(n, alpha, T, R, positionSeed, samplingSeed, radii, angles);
+}
 
-    return result;
+std::vector<std::pair<int64_t, int64_t> > generatePositionsAndEdges64(long long n, double alpha, double T, double R, int positionSeed, int samplingSeed,
+                                                                      double* radii, double* angles) {
+    return generatePositionsAndEdgesImpl<int64_t>(n, alpha, T, R, positionSeed, samplingSeed, radii, angles);
 }
 
 } // namespace hypergirgs
@@ -1,19 +1,191 @@
 
 #include <hypergirgs/RadiusLayer.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <omp.h>
 
 #include <hypergirgs/AngleHelper.h>
+#include <hypergirgs/BatchMath.h>
 #include <hypergirgs/ScopedTimer.h>
 #include <hypergirgs/IntSort.h>
+#include <hypergirgs/Random.h>
 
 
 namespace hypergirgs {
 
-RadiusLayer::RadiusLayer(double r_min, double r_max, unsigned int targetLevel,
-                         const Point* base,
-                         const unsigned int* prefix_sum)
+namespace {
+
+// the radius layers and their cells; shared by buildPartition() and samplePartition()
+struct LayerGeometry {
+    LayerGeometry(double R, double layer_height)
+        : R(R)
+        , layer_height(layer_height)
+        , num_layers(static_cast<unsigned int>(std::ceil(R / layer_height)))
+        , level_of_layer(num_layers)
+        , first_cell_of_layer(num_layers)
+    {
+        // generate look-up to get the level of a layer
+        const auto r_min_outer = R - layer_height;
+        for (auto l = 0u; l < num_layers; ++l)
+            level_of_layer[l] = RadiusLayer<>::partitioningBaseLevel(radMin(l), r_min_outer, R);
+        assert(std::is_sorted(level_of_layer.crbegin(), level_of_layer.crend()));
+
+        // since there can be multiple layers at the same level, we cannot
+        // rely on AngleHelper::firstCellInLevel to find a unique first cell
+        // of a layer. Hence we precompute the first cell as a (reverse)
+        // prefix sum
+        unsigned int sum = 0;
+        for (auto l = num_layers; l--;) {
+            first_cell_of_layer[l] = sum;
+            sum += AngleHelper::numCellsInLevel(level_of_layer[l]);
+        }
+        max_cell_id = sum;
+    }
+
+    // translate radius <-> layer
+    unsigned int layer(double radius) const { return static_cast<unsigned int>((R - radius) / layer_height); }
+    double radMax(int l) const { return R - l * layer_height; }
+    double radMin(int l) const { return R - l * layer_height - layer_height; }
+
+    const double R;
+    const double layer_height;
+    const unsigned int num_layers;
+    std::vector<int> level_of_layer;
+    std::vector<unsigned int> first_cell_of_layer;
+    unsigned int max_cell_id;
+};
+
+// the terms of a batch of points (see batch_math::pointTerms)
+struct PointTermsBatch {
+    void compute(const double* radii, const double* angles, unsigned int count) noexcept {
+        batch_math::pointTerms(radii, angles, count, invsinh_r, coth_r, cos_phi, sin_phi);
+    }
+
+    template <typename NodeId>
+    Point<NodeId> point(unsigned int k, NodeId id, double radius, double angle, int cell_id) const noexcept {
+        return {id, radius, angle, cell_id, invsinh_r[k], coth_r[k], cos_phi[k], sin_phi[k]};
+    }
+
+    double invsinh_r[batch_math::batch_size];
+    double coth_r[batch_math::batch_size];
+    double cos_phi[batch_math::batch_size];
+    double sin_phi[batch_math::batch_size];
+};
+
+// prunes empty layers at the back and builds the radius layers for the sorted points
+template <typename NodeId>
+std::vector<RadiusLayer<NodeId>> buildRadiusLayers(const LayerGeometry& geometry,
+        const std::vector<Point<NodeId>>& points, const std::vector<NodeId>& first_in_cell, bool enable_profiling) {
+
+    // the first point lies in the innermost non-empty layer
+    auto num_layers = 1u;
+    while (geometry.first_cell_of_layer[num_layers - 1] > static_cast<unsigned int>(points[0].cell_id))
+        ++num_layers;
+
+    // build spatial structure and find insertion level for each layer based on lower bound on radius for current and smallest layer
+    std::vector<RadiusLayer<NodeId>> radius_layers;
+    radius_layers.reserve(num_layers);
+    {
+        ScopedTimer timer("Build data structure", enable_profiling);
+        for (auto layer = 0u; layer < num_layers; ++layer) {
+            radius_layers.emplace_back(
+                geometry.radMin(layer), geometry.radMax(layer), geometry.level_of_layer[layer],
+                points.data(), first_in_cell.data() + geometry.first_cell_of_layer[layer]);
+        }
+    }
+
+    return radius_layers;
+}
+
+// Estimated running time of HyperbolicTree for the given layer height, in units of a type 1 check for T > 0.
+// The expected number of points per layer gives the expected number of
+//  - type 1 checks: 1.5/2^L of the pairs of two layers (in both orders) in their partitioning base level L,
+//  - type 2 proposals: the pairs of two layers in non-touching cells of level 2, ..., L times the max connection prob
+//    (type 1 checks if the latter exceeds 0.2; see HyperbolicTree::sampleTypeII),
+//  - type 2 samples of a layer pair in a cell pair with points in both cells (each sets up a geometric distribution),
+//  - cells of the partition and preprocessed layer pairs per level.
+// The weights of the terms were fitted to the running times for n = 1e5, 1e6, alpha = 0.6, 1, T = 0, 0.5, 0.9,
+// average degree 10, 100 and layer heights from 0.5 to 4.
+double estimatedCost(double n, double alpha, double T, double R, double layer_height) {
+    constexpr double cost_type1_threshold = 0.32; // a type 1 check for T = 0 (with angular windows)
+    constexpr double cost_type1 = 1.0;
+    constexpr double cost_type2 = 8.8;
+    constexpr double cost_type2_sample = 25.0;
+    constexpr double cost_cell = 33.0;
+    constexpr double cost_layer_pair = 2050.0;
+
+    const LayerGeometry geometry(R, layer_height);
+    const auto threshold = T <= std::numeric_limits<double>::epsilon();
+
+    // share of points with radius at most r, i.e. (cosh(alpha*r) - 1) / (cosh(alpha*R) - 1) rewritten s.t. it does not overflow
+    const auto cdf = [&] (double r) -> double {
+        r = std::min(std::max(r, 0.0), R);
+        const auto ratio = (1.0 - std::exp(-alpha * r)) / (1.0 - std::exp(-alpha * R));
+        return std::exp(alpha * (r - R)) * ratio * ratio;
+    };
+
+    // like buildRadiusLayers(), drop the inner layers that are expected to be empty
+    std::vector<double> points_in_layer;
+    for (auto l = 0u; l < geometry.num_layers && n * cdf(geometry.radMax(l)) >= 0.5; ++l)
+        points_in_layer.push_back(n * (cdf(geometry.radMax(l)) - cdf(geometry.radMin(l))));
+    const auto layers = std::max<size_t>(points_in_layer.size(), 1);
+    points_in_layer.resize(layers);
+
+    auto type1 = 0.0;
+    auto type2 = 0.0;
+    auto type2_samples = 0.0;
+    auto cells = 0.0;
+    for (auto l = 0u; l < layers; ++l)
+        cells += std::ldexp(1.0, geometry.level_of_layer[l]);
+
+    for (auto i = 0u; i < layers; ++i) {
+        for (auto j = i; j < layers; ++j) {
+            const auto r1 = geometry.radMin(i);
+            const auto r2 = geometry.radMin(j);
+            const auto PBL = RadiusLayer<>::partitioningBaseLevel(r1, r2, R);
+            const auto both_orders = (i == j) ? 1.0 : 2.0; // the layer pairs (i,j) and (j,i)
+            const auto pairs = both_orders * points_in_layer[i] * points_in_layer[j];
+
+            // 2^L A,A and 2^L A,A+1 cell pairs, the former for i <= j only
+            type1 += 1.5 * std::ldexp(pairs, -static_cast<int>(PBL));
+            if (threshold)
+                continue;
+
+            // per level 2^l A,A+2 and 2^(l-1) A,A+3 cell pairs
+            for (auto level = 2u; level <= PBL; ++level) {
+                const auto firstCell = AngleHelper::firstCellOfLevel(level);
+                const auto non_empty_i = 1.0 - std::exp(-std::ldexp(points_in_layer[i], -static_cast<int>(level)));
+                const auto non_empty_j = 1.0 - std::exp(-std::ldexp(points_in_layer[j], -static_cast<int>(level)));
+                type2_samples += 1.5 * std::ldexp(both_orders, level) * non_empty_i * non_empty_j;
+
+                for (auto cells_between = 1u; cells_between <= 2; ++cells_between) {
+                    const auto dist = hyperbolicDistance(r1, 0, r2, AngleHelper::dist(firstCell, firstCell + cells_between + 1, level));
+                    const auto max_connection_prob = 1.0 / (1.0 + std::exp(0.5 / T * (dist - R)));
+                    const auto level_pairs = std::ldexp(pairs, -static_cast<int>(level)) / cells_between;
+                    if (max_connection_prob > 0.2)
+                        type1 += level_pairs;
+                    else
+                        type2 += level_pairs * max_connection_prob;
+                }
+            }
+        }
+    }
+
+    const auto levels = geometry.level_of_layer[layers - 1] + 1.0;
+    return (threshold ? cost_type1_threshold : cost_type1) * type1 + cost_type2 * type2 + cost_type2_sample * type2_samples
+         + cost_cell * cells + cost_layer_pair * layers * layers * levels;
+}
+
+} // namespace
+
+template <typename NodeId>
+RadiusLayer<NodeId>::RadiusLayer(double r_min, double r_max, unsigned int targetLevel,
+                         const Point<NodeId>* base,
+                         const NodeId* prefix_sum)
     : m_r_min{r_min}, 
       m_r_max{r_max}, 
       m_target_level{targetLevel}, 
@@ -34,63 +206,50 @@ RadiusLayer::RadiusLayer(double r_min, double r_max, unsigned int targetLevel,
 #endif
 }
 
-std::vector<RadiusLayer> RadiusLayer::buildPartition(const std::vector<double>& radii, const std::vector<double>& angles,
+template <typename NodeId>
+std::vector<RadiusLayer<NodeId>> RadiusLayer<NodeId>::buildPartition(const std::vector<double>& radii, const std::vector<double>& angles,
                             const double R, const double layer_height, 
-                            std::vector<Point>& points, std::vector<unsigned int>& first_in_cell, // output parameter
+                            std::vector<Point<NodeId>>& points, std::vector<NodeId>& first_in_cell, // output parameter
                             bool enable_profiling) {
 
     assert(radii.size() == angles.size());
     assert(layer_height <= R);
 
-    const auto n = radii.size();
+    const auto n = static_cast<NodeId>(radii.size());
 
-    // translate radius <-> layer
-    auto radius_to_layer = [R, layer_height] (double radius) {return static_cast<unsigned int>( (R - radius) / layer_height );};
-    auto layer_rad_max   = [R, layer_height] (int l) {return R - l * layer_height;};
-    auto layer_rad_min   = [R, layer_height] (int l) {return R - l * layer_height - layer_height;};
-    const auto r_min_outer = R - layer_height;
-    auto num_layers = static_cast<unsigned int>(std::ceil( R / layer_height));
-
-    // generate look-up to get the level of a layer
-    const auto level_of_layer = [&] {
-        std::vector<int> level_of_layer(num_layers);
-        for (int l = 0; l < num_layers; ++l) {
-            level_of_layer[l] = partitioningBaseLevel(layer_rad_min(l), r_min_outer, R);
-        }
-        assert(std::is_sorted(level_of_layer.crbegin(), level_of_layer.crend()));
-        return level_of_layer;
-    }();
-
-    // since there can be multiple layers at the same level, we cannot
-    // rely on AngleHelper::firstCellInLevel to find a unique first cell
-    // of a layer. Hence we precompute the first cell as a (reverse)
-    // prefix sum
-    const auto first_cell_of_layer = [&] {
-        std::vector<unsigned int> first_cell_of_layer(num_layers);
-        unsigned int sum = 0;
-        for (auto l = num_layers; l--;) {
-            first_cell_of_layer[l] = sum;
-            sum += AngleHelper::numCellsInLevel(level_of_layer[l]);
-        }
-        return first_cell_of_layer;
-    }();
-    const auto max_cell_id = first_cell_of_layer.front() + AngleHelper::numCellsInLevel(level_of_layer[0]);
+    const LayerGeometry geometry(R, layer_height);
+    const auto& level_of_layer = geometry.level_of_layer;
+    const auto& first_cell_of_layer = geometry.first_cell_of_layer;
+    const auto max_cell_id = geometry.max_cell_id;
 
-    points = std::vector<Point>(n);
+    points = std::vector<Point<NodeId>>(n);
     // pre-compute values for fast distance computation and also compute
     // the cell a point belongs to
     {
         ScopedTimer timer("Classify points & precompute coordinates", enable_profiling);
 
-        #pragma omp parallel for
-        for (int i = 0; i < n; ++i) {
-            assert(0 <= radii[i] && radii[i] < R);
-            assert(0 <= angles[i] && angles[i] < 2*PI);
-
-            const auto layer = radius_to_layer(radii[i]);
-            const auto level = level_of_layer[layer];
-            const auto cell = first_cell_of_layer[layer] + AngleHelper::cellForPoint(angles[i], level);
-            points[i] = Point(i, radii[i], angles[i], cell);
+        // the transcendental functions are evaluated in vectorized batches
+        constexpr auto batch_size = static_cast<NodeId>(batch_math::batch_size);
+        #pragma omp parallel
+        {
+            PointTermsBatch terms;
+
+            #pragma omp for schedule(static)
+            for (NodeId first = 0; first < n; first += batch_size) {
+                const auto count = static_cast<unsigned int>(std::min(batch_size, n - first));
+                terms.compute(radii.data() + first, angles.data() + first, count);
+
+                for (auto k = 0u; k < count; ++k) {
+                    const auto i = first + k;
+                    assert(0 <= radii[i] && radii[i] < R);
+                    assert(0 <= angles[i] && angles[i] < 2*PI);
+
+                    const auto layer = geometry.layer(radii[i]);
+                    const auto level = level_of_layer[layer];
+                    const auto cell = first_cell_of_layer[layer] + AngleHelper::cellForPoint(angles[i], level);
+                    points[i] = terms.point<NodeId>(k, i, radii[i], angles[i], cell);
+                }
+            }
         }
     }
 
@@ -98,20 +257,17 @@ std::vector<RadiusLayer> RadiusLayer::buildPartition(const std::vector<double>&
     {
         ScopedTimer timer("Sort points", enable_profiling);
 
-        auto compare = [](const Point &a, const Point &b) { return a.cell_id < b.cell_id; };
+        auto compare = [](const Point<NodeId> &a, const Point<NodeId> &b) { return a.cell_id < b.cell_id; };
 
-        intsort::intsort(points, [](const Point &p) { return p.cell_id; }, max_cell_id + 1);
+        intsort::intsort(points, [](const Point<NodeId> &p) { return p.cell_id; }, max_cell_id + 1);
         //alternatively: std::sort(points.begin(), points.end(), compare);
 
         assert(std::is_sorted(points.begin(), points.end(), compare));
     }
 
-    // prune of empty layers at the back
-    for (num_layers = 1; first_cell_of_layer[num_layers - 1] > points[0].cell_id; ++num_layers) {}
-
     // compute pointers (prefix sums) into points
-    constexpr auto gap_cell_indicator = std::numeric_limits<unsigned int>::max();
-    first_in_cell = std::vector<unsigned int>(max_cell_id + 1, gap_cell_indicator);
+    constexpr auto gap_cell_indicator = std::numeric_limits<NodeId>::max();
+    first_in_cell = std::vector<NodeId>(max_cell_id + 1, gap_cell_indicator);
     {
         ScopedTimer timer("Find first point in cell", enable_profiling);
 
@@ -122,7 +278,7 @@ std::vector<RadiusLayer> RadiusLayer::buildPartition(const std::vector<double>&
         first_in_cell[max_cell_id] = n;
 
         #pragma omp parallel for
-        for (int i = 1; i < n; ++i) {
+        for (NodeId i = 1; i < n; ++i) {
             if (points[i - 1].cell_id != points[i].cell_id) {
                 first_in_cell[points[i].cell_id] = i;
             }
@@ -183,19 +339,309 @@ std::vector<RadiusLayer> RadiusLayer::buildPartition(const std::vector<double>&
         #endif
     }
 
-    // build spatial structure and find insertion level for each layer based on lower bound on radius for current and smallest layer
-    std::vector<RadiusLayer> radius_layers;
-    radius_layers.reserve(num_layers);
+    return buildRadiusLayers(geometry, points, first_in_cell, enable_profiling);
+}
+
+template <typename NodeId>
+std::vector<RadiusLayer<NodeId>> RadiusLayer<NodeId>::samplePartition(long long num_nodes, const double alpha, const double R, const double layer_height,
+                            uint64_t seed,
+                            std::vector<Point<NodeId>>& points, std::vector<NodeId>& first_in_cell, // output parameter
+                            double* radii, double* angles, // optional output parameter
+                            bool enable_profiling) {
+
+    assert(layer_height <= R);
+
+    const auto n = static_cast<NodeId>(num_nodes);
+    const LayerGeometry geometry(R, layer_height);
+    const auto num_layers = geometry.num_layers;
+    const auto& first_cell_of_layer = geometry.first_cell_of_layer;
+    const auto max_cell_id = geometry.max_cell_id;
+
+    // The radii have a density proportional to sinh(alpha*r) on [0, R), i.e. cosh(alpha*r) is uniform in [1, cosh(alpha*R)).
+    // cosh_bound[l] and cosh_bound[l+1] are the bounds of layer l in this space.
+    auto cosh_bound = std::vector<double>(num_layers + 1);
+    for (auto l = 0u; l <= num_layers; ++l)
+        cosh_bound[l] = std::cosh(alpha * std::max(0.0, geometry.radMax(l)));
+    cosh_bound[num_layers] = 1.0;
+
+    // The cells of bucket_level(l) are the buckets of layer l, i.e. at most 2^10 per layer.
+    // This is coarse enough for a single counting sort pass and fine enough that a bucket fits in the cache.
+    // Buckets are ordered like the cells, i.e. inner layers first.
+    constexpr auto bucket_bits = 10u;
+    auto bucket_level = [&] (unsigned int layer) {
+        return std::min(static_cast<unsigned int>(geometry.level_of_layer[layer]), bucket_bits);
+    };
+    auto first_bucket_of_layer = std::vector<uint32_t>(num_layers);
+    uint32_t num_buckets = 0;
+    for (auto l = num_layers; l--;) {
+        first_bucket_of_layer[l] = num_buckets;
+        num_buckets += AngleHelper::numCellsInLevel(bucket_level(l));
+    }
+
+    // Nodes are assigned to buckets in blocks of this size. Each block has its own random stream (keyed after the
+    // streams of the buckets), so the assignment does not depend on the number of threads.
+    constexpr auto block_size = 1ll << 16;
+    const auto blocks = (static_cast<long long>(n) + block_size - 1) / block_size;
+    const auto blocks_key = streamKey(seed, num_buckets);
+
+    // distribute the nodes uniformly at random into the buckets; a node's layer follows from its radius
+    auto first_in_bucket = std::vector<NodeId>(static_cast<size_t>(num_buckets) + 1);
+    auto ids_by_bucket = std::vector<NodeId>(n);
     {
-        ScopedTimer timer("Build data structure", enable_profiling);
-        for (auto layer = 0u; layer < num_layers; ++layer) {
-            radius_layers.emplace_back(
-                layer_rad_min(layer), layer_rad_max(layer), level_of_layer[layer], 
-                points.data(), first_in_cell.data() + first_cell_of_layer[layer]);
+        ScopedTimer timer("Distribute points into buckets", enable_profiling);
+
+        const auto max_threads = omp_get_max_threads();
+        auto bucket_of_node = std::vector<uint32_t>(n);
+        auto local_counts = std::vector<std::vector<NodeId>>(max_threads, std::vector<NodeId>(num_buckets, 0));
+
+        #pragma omp parallel num_threads(max_threads)
+        {
+            auto& counts = local_counts[omp_get_thread_num()];
+
+            #pragma omp for schedule(static)
+            for (long long block = 0; block < blocks; ++block) {
+                auto gen = SplitMix64{streamKey(blocks_key, block)};
+                const auto end = std::min<long long>(n, (block + 1) * block_size);
+                for (auto i = block * block_size; i < end; ++i) {
+                    // the layer whose bounds enclose c; most nodes are in the outer layers, so a linear search is fastest
+                    const auto c = 1.0 + (cosh_bound[0] - 1.0) * uniformUnit(gen);
+                    auto layer = 0u;
+                    while (c < cosh_bound[layer + 1])
+                        ++layer;
+                    assert(layer < num_layers);
+                    const auto buckets = AngleHelper::numCellsInLevel(bucket_level(layer));
+                    const auto bucket = first_bucket_of_layer[layer] + static_cast<uint32_t>(gen() & (buckets - 1));
+                    bucket_of_node[i] = bucket;
+                    ++counts[bucket];
+                }
+            }
+
+            // each thread gets its own range in each bucket; with the static schedule
+            // the threads see consecutive blocks, so each bucket is ordered by node id
+            #pragma omp single
+            {
+                NodeId sum = 0;
+                for (uint32_t bucket = 0; bucket < num_buckets; ++bucket) {
+                    first_in_bucket[bucket] = sum;
+                    for (auto& each : local_counts) {
+                        const auto count = each[bucket];
+                        each[bucket] = sum;
+                        sum += count;
+                    }
+                }
+                first_in_bucket[num_buckets] = sum;
+            }
+
+            #pragma omp for schedule(static)
+            for (long long block = 0; block < blocks; ++block) {
+                const auto end = std::min<long long>(n, (block + 1) * block_size);
+                for (auto i = block * block_size; i < end; ++i)
+                    ids_by_bucket[counts[bucket_of_node[i]]++] = static_cast<NodeId>(i);
+            }
         }
+
+        assert(first_in_bucket[num_buckets] == n);
     }
 
-    return radius_layers;
+    // Within each bucket, assign the points to uniformly random cells of the target level and sort them by cell
+    // (in the cache). Finally, sample radii and angles within the cells, i.e. directly in sorted order.
+    points = std::vector<Point<NodeId>>(n);
+    first_in_cell = std::vector<NodeId>(static_cast<size_t>(max_cell_id) + 1);
+    first_in_cell[max_cell_id] = n;
+    {
+        ScopedTimer timer("Sample points & precompute coordinates", enable_profiling);
+
+        #pragma omp parallel
+        {
+            std::vector<NodeId> sorted_ids;
+            std::vector<unsigned int> cell_of_node;
+            std::vector<NodeId> cell_begin;
+            std::vector<double> bucket_radii;
+            std::vector<double> bucket_angles;
+            PointTermsBatch terms;
+
+            #pragma omp for schedule(dynamic, 16)
+            for (long long bucket = 0; bucket < static_cast<long long>(num_buckets); ++bucket) {
+                auto layer = 0u;
+                while (first_bucket_of_layer[layer] > bucket)
+                    ++layer;
+                const auto level = bucket_level(layer);
+                const auto target_level = static_cast<unsigned int>(geometry.level_of_layer[layer]);
+                const auto bucket_cell = static_cast<unsigned int>(bucket - first_bucket_of_layer[layer]);
+
+                // the descendants of a cell are consecutive in each level below
+                const auto child_bits = target_level - level;
+                const auto first_cell = bucket_cell << child_bits;
+                const auto cells = AngleHelper::numCellsInLevel(child_bits);
+
+                const auto begin = first_in_bucket[bucket];
+                const auto end = first_in_bucket[bucket + 1];
+                const auto size = static_cast<size_t>(end - begin);
+
+                auto gen = SplitMix64{streamKey(seed, bucket)};
+
+                // counting sort by cell
+                const auto bucket_ids = ids_by_bucket.data() + begin;
+                cell_of_node.resize(size);
+                cell_begin.assign(cells + 1, 0);
+                for (size_t k = 0; k < size; ++k) {
+                    cell_of_node[k] = child_bits ? static_cast<unsigned int>(gen() >> (64 - child_bits)) : 0u;
+                    ++cell_begin[cell_of_node[k] + 1];
+                }
+                for (auto cell = 0u; cell < cells; ++cell)
+                    cell_begin[cell + 1] += cell_begin[cell];
+
+                const auto prefix_sums = first_in_cell.data() + first_cell_of_layer[layer] + first_cell;
+                for (auto cell = 0u; cell < cells; ++cell)
+                    prefix_sums[cell] = begin + cell_begin[cell];
+
+                sorted_ids.resize(size);
+                bucket_radii.resize(size);
+                bucket_angles.resize(size);
+                for (size_t k = 0; k < size; ++k)
+                    sorted_ids[cell_begin[cell_of_node[k]]++] = bucket_ids[k];
+
+                // sample the coordinates cell by cell; cell_begin now holds the end of each cell
+                const auto cosh_min = cosh_bound[layer + 1];
+                const auto cosh_range = cosh_bound[layer] - cosh_min;
+                auto k = size_t{0};
+                for (auto cell = 0u; cell < cells; ++cell) {
+                    const auto local_cell = first_cell + cell;
+                    const auto bounds = AngleHelper::bounds(AngleHelper::firstCellOfLevel(target_level) + local_cell, target_level);
+                    const auto cell_id = first_cell_of_layer[layer] + local_cell;
+
+                    for (; k < static_cast<size_t>(cell_begin[cell]); ++k) {
+                        // rounding must neither move a point into another cell nor layer; redraw in these rare cases
+                        double angle, radius;
+                        do {
+                            angle = bounds.first + (bounds.second - bounds.first) * uniformUnit(gen);
+                        } while (!(angle < 2*PI) || AngleHelper::cellForPoint(angle, target_level) != local_cell);
+                        do {
+                            radius = std::acosh(cosh_min + cosh_range * uniformUnit(gen)) / alpha;
+                        } while (!(0 < radius && radius < R) || geometry.layer(radius) != layer);
+
+                        bucket_radii[k] = radius;
+                        bucket_angles[k] = angle;
+                        cell_of_node[k] = cell_id; // not needed for the sort anymore
+                    }
+                }
+                assert(k == size);
+
+                // the transcendental functions are evaluated in vectorized batches
+                for (size_t first = 0; first < size; first += batch_math::batch_size) {
+                    const auto count = static_cast<unsigned int>(std::min<size_t>(batch_math::batch_size, size - first));
+                    terms.compute(bucket_radii.data() + first, bucket_angles.data() + first, count);
+                    for (auto j = 0u; j < count; ++j) {
+                        k = first + j;
+                        points[begin + k] = terms.point<NodeId>(j, sorted_ids[k], bucket_radii[k], bucket_angles[k],
+                                                                static_cast<int>(cell_of_node[k]));
+                    }
+                }
+
+                // the ids are scattered; writing them in a separate loop keeps more cache misses in flight
+                if (radii)
+                    for (k = 0; k < size; ++k)
+                        radii[sorted_ids[k]] = bucket_radii[k];
+                if (angles)
+                    for (k = 0; k < size; ++k)
+                        angles[sorted_ids[k]] = bucket_angles[k];
+            }
+        }
+    }
+
+    return buildRadiusLayers(geometry, points, first_in_cell, enable_profiling);
+}
+
+template <typename NodeId>
+void RadiusLayer<NodeId>::sortCellsByAngle(std::vector<Point<NodeId>>& points, const std::vector<NodeId>& first_in_cell,
+                                           std::vector<double>& angles, bool enable_profiling) {
+    ScopedTimer timer("Sort cells by angle", enable_profiling);
+
+    const auto num_cells = static_cast<long long>(first_in_cell.size()) - 1;
+    angles.resize(points.size());
+
+    #pragma omp parallel
+    {
+        std::vector<std::pair<double, Point<NodeId>>> large_cell;
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (long long cell = 0; cell < num_cells; ++cell) {
+            const auto begin = static_cast<size_t>(first_in_cell[cell]);
+            const auto end = static_cast<size_t>(first_in_cell[cell + 1]);
+
+            for (auto k = begin; k < end; ++k)
+                angles[k] = angleOf(points[k]);
+
+            // most cells hold only a few points; insertion sort moves the angles and points together
+            if (end - begin <= 32) {
+                for (auto k = begin + 1; k < end; ++k) {
+                    const auto angle = angles[k];
+                    const auto point = points[k];
+                    auto pos = k;
+                    for (; pos > begin && angles[pos - 1] > angle; --pos) {
+                        angles[pos] = angles[pos - 1];
+                        points[pos] = points[pos - 1];
+                    }
+                    angles[pos] = angle;
+                    points[pos] = point;
+                }
+                continue;
+            }
+
+            large_cell.clear();
+            for (auto k = begin; k < end; ++k)
+                large_cell.emplace_back(angles[k], points[k]);
+            std::sort(large_cell.begin(), large_cell.end(),
+                      [] (const std::pair<double, Point<NodeId>>& a, const std::pair<double, Point<NodeId>>& b) {
+                          return a.first < b.first;
+                      });
+            for (auto k = begin; k < end; ++k) {
+                angles[k] = large_cell[k - begin].first;
+                points[k] = large_cell[k - begin].second;
+            }
+        }
+    }
+}
+
+template <typename NodeId>
+double RadiusLayer<NodeId>::autoLayerHeight(long long n, double alpha, double T, double R) {
+    const double candidates[] = {0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 2.5, 3.0, 4.0};
+    constexpr auto num_candidates = sizeof(candidates) / sizeof(candidates[0]);
+
+    double costs[num_candidates];
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < static_cast<int>(num_candidates); ++k)
+        costs[k] = candidates[k] <= R ? estimatedCost(static_cast<double>(n), alpha, T, R, candidates[k])
+                                      : std::numeric_limits<double>::infinity();
+
+    const auto best = std::min_element(costs, costs + num_candidates) - costs;
+    return std::isinf(costs[best]) ? R : candidates[best];
 }
 
+template <typename NodeId>
+double RadiusLayer<NodeId>::autoLayerHeight(const std::vector<double>& radii, double T, double R) {
+    // maximum likelihood estimate of alpha for the density alpha*exp(-alpha*(R-r)), which approximates
+    // alpha*sinh(alpha*r)/(cosh(alpha*R)-1) of sampleRadii()
+    // the sum is taken over fixed blocks combined in order, s.t. the layer height does not depend on the number of threads
+    constexpr long long block_size = 1 << 16;
+    const auto n = static_cast<long long>(radii.size());
+    const auto blocks = (n + block_size - 1) / block_size;
+    auto block_depths = std::vector<double>(blocks);
+    #pragma omp parallel for schedule(static)
+    for (long long block = 0; block < blocks; ++block) {
+        auto block_depth = 0.0;
+        const auto end = std::min(n, (block + 1) * block_size);
+        for (auto k = block * block_size; k < end; ++k)
+            block_depth += R - radii[k];
+        block_depths[block] = block_depth;
+    }
+    const auto depth = std::accumulate(block_depths.begin(), block_depths.end(), 0.0);
+    const auto alpha = depth > 0.0 ? n / depth : 1.0;
+
+    return autoLayerHeight(n, alpha, T, R);
+}
+
+template class RadiusLayer<int>;
+template class RadiusLayer<int64_t>;
+
 } // namespace hypergirgs
@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <girgs/BinaryFormat.h>
+#include <girgs/Generator.h>
+
+
+class BinaryFormat_test : public ::testing::Test {
+protected:
+    void TearDown() override {
+        std::remove(file.c_str());
+    }
+
+    const std::string file = "binary_format_test.bin";
+};
+
+
+TEST_F(BinaryFormat_test, roundTrip) {
+    const auto n = 1000;
+    const auto d = 2;
+    auto weights = girgs::generateWeights(n, 2.5, 12);
+    auto positions = std::vector<double>(n * d);
+    girgs::generatePositions(n, d, 130, positions.data(), d);
+    const auto scaling = girgs::scaleWeights(weights, 10, d, 2.0);
+    const auto edges = girgs::generateEdges(weights, positions.data(), d, d, 2.0, 1400);
+
+    girgs::BinaryHeader header;
+    header.n = n;
+    header.dimension = d;
+    header.alpha = 2.0;
+    header.ple = 2.5;
+    header.avg_degree = 10;
+    header.weight_scaling = scaling;
+    header.seeds[0] = 12;
+    header.seeds[1] = 130;
+    header.seeds[2] = 1400;
+    girgs::saveBinary(file, header, edges, weights.data(), positions.data());
+
+    // fixed size header, two 32 bit ids per edge, weight and coordinates per node
+    std::ifstream f(file, std::ios::binary | std::ios::ate);
+    EXPECT_EQ(static_cast<size_t>(f.tellg()), 128 + edges.size() * 8 + n * (d + 1) * 8);
+
+    const auto graph = girgs::loadBinary(file);
+    EXPECT_EQ(graph.header.model, girgs::BinaryHeader::girg);
+    EXPECT_EQ(graph.header.id_bytes, 4u);
+    EXPECT_EQ(graph.header.has_nodes, 1u);
+    EXPECT_EQ(graph.header.n, static_cast<uint64_t>(n));
+    EXPECT_EQ(graph.header.m, edges.size());
+    EXPECT_EQ(graph.header.dimension, static_cast<uint32_t>(d));
+    EXPECT_EQ(graph.header.alpha, 2.0);
+    EXPECT_EQ(graph.header.ple, 2.5);
+    EXPECT_EQ(graph.header.weight_scaling, scaling);
+    EXPECT_EQ(graph.header.seeds[1], 130);
+
+    ASSERT_EQ(graph.edges.size(), edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        EXPECT_EQ(graph.edges[i].first, edges[i].first);
+        EXPECT_EQ(graph.edges[i].second, edges[i].second);
+    }
+    EXPECT_EQ(graph.weights, weights); // bit exact, unlike the text formats
+    EXPECT_EQ(graph.coordinates, positions);
+
+    const auto withoutNodes = girgs::loadBinary(file, false);
+    EXPECT_EQ(withoutNodes.edges, graph.edges);
+    EXPECT_TRUE(withoutNodes.weights.empty());
+    EXPECT_TRUE(withoutNodes.coordinates.empty());
+}
+
+TEST_F(BinaryFormat_test, ids64) {
+    const int64_t big = (1ll << 40) + 3;
+    const std::vector<std::pair<int64_t, int64_t>> edges = {{0, 1}, {big, -1}, {7, big + 1}};
+
+    girgs::BinaryHeader header;
+    header.model = girgs::BinaryHeader::hyperbolic;
+    header.n = big + 2;
+    header.dimension = 1;
+    header.seeds[0] = -5;
+    girgs::saveBinary(file, header, edges);
+
+    const auto graph = girgs::loadBinary(file);
+    EXPECT_EQ(graph.header.model, girgs::BinaryHeader::hyperbolic);
+    EXPECT_EQ(graph.header.id_bytes, 8u);
+    EXPECT_EQ(graph.header.has_nodes, 0u);
+    EXPECT_EQ(graph.header.n, static_cast<uint64_t>(big + 2));
+    EXPECT_EQ(graph.header.seeds[0], -5);
+    EXPECT_EQ(graph.edges, edges);
+    EXPECT_TRUE(graph.weights.empty());
+}
+
+TEST_F(BinaryFormat_test, littleEndianLayout) {
+    girgs::BinaryHeader header;
+    header.n = 0x0102;
+    girgs::saveBinary(file, header, std::vector<std::pair<int,int>>{{0x0a0b0c0d, -2}});
+
+    std::ifstream f(file, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(bytes.size(), 128u + 8u);
+    EXPECT_EQ(std::string(bytes.data(), 8), "GIRGSBIN");
+    EXPECT_EQ(bytes[8], 1); // version
+    EXPECT_EQ(bytes[32], 0x02); // n
+    EXPECT_EQ(bytes[33], 0x01);
+    EXPECT_EQ(bytes[40], 1); // m
+    EXPECT_EQ(bytes[128], 0x0d);
+    EXPECT_EQ(bytes[131], 0x0a);
+    EXPECT_EQ(static_cast<unsigned char>(bytes[132]), 0xfe);
+    EXPECT_EQ(static_cast<unsigned char>(bytes[135]), 0xff);
+}
+
+TEST_F(BinaryFormat_test, rejectsInvalidFiles) {
+    EXPECT_THROW(girgs::loadBinary("does_not_exist.bin"), std::runtime_error);
+
+    {
+        std::ofstream f(file, std::ios::binary);
+        f << "graph girg {\n";
+    }
+    EXPECT_THROW(girgs::loadBinary(file), std::runtime_error);
+
+    // truncated edge array
+    girgs::BinaryHeader header;
+    header.n = 10;
+    girgs::saveBinary(file, header, std::vector<std::pair<int,int>>{{0, 1}, {2, 3}});
+    {
+        std::fstream f(file, std::ios::binary | std::ios::in | std::ios::out);
+        f.seekp(40);
+        const char m = 3;
+        f.write(&m, 1);
+    }
+    EXPECT_THROW(girgs::loadBinary(file), std::runtime_error);
+
+    // corrupted sizes (n at offset 32, m at 40) must not be allocated
+    header.dimension = 2;
+    const auto nodes = std::vector<double>(header.n * header.dimension, 0.5);
+    for (auto offset : {32, 40}) {
+        girgs::saveBinary(file, header, std::vector<std::pair<int,int>>{{0, 1}, {2, 3}}, nodes.data(), nodes.data());
+        {
+            std::fstream f(file, std::ios::binary | std::ios::in | std::ios::out);
+            f.seekp(offset + 5);
+            const char huge = 0x10;
+            f.write(&huge, 1);
+        }
+        EXPECT_THROW(girgs::loadBinary(file), std::runtime_error);
+    }
+}
@@ -177,3 +177,59 @@ TYPED_TEST(BitManipulationTest, XRef) {
         ASSERT_EQ(cell, depo) << extr;
     }
 }
+
+
+template <typename T>
+class BitManipulation64Test : public ::testing::Test {
+public:
+    using Implementation = T;
+};
+
+using Implementations64 = ::testing::Types<
+#ifdef USE_BMI2
+    girgs::BitManipulationDetails::BMI2::Implementation<1, uint64_t>,
+    girgs::BitManipulationDetails::BMI2::Implementation<2, uint64_t>,
+    girgs::BitManipulationDetails::BMI2::Implementation<3, uint64_t>,
+    girgs::BitManipulationDetails::BMI2::Implementation<4, uint64_t>,
+    girgs::BitManipulationDetails::BMI2::Implementation<5, uint64_t>,
+#endif
+    girgs::BitManipulationDetails::Generic::Implementation<1, uint64_t>,
+    girgs::BitManipulationDetails::Generic::Implementation<2, uint64_t>,
+    girgs::BitManipulationDetails::Generic::Implementation<3, uint64_t>,
+    girgs::BitManipulationDetails::Generic::Implementation<4, uint64_t>,
+    girgs::BitManipulationDetails::Generic::Implementation<5, uint64_t>
+>;
+
+TYPED_TEST_SUITE(BitManipulation64Test, Implementations64,);
+
+template <unsigned D>
+static uint64_t ReferenceDeposite64(std::array<uint64_t, D> coord, unsigned levels) {
+    uint64_t res = 0;
+
+    for(unsigned i = 0; i < D * levels; ++i) {
+        const auto d = i % D;
+        res |= ((coord[d] >> (i / D)) & 1) << i;
+    }
+
+    return res;
+}
+
+TYPED_TEST(BitManipulation64Test, DepositeExtract) {
+    using Impl = typename TestFixture::Implementation;
+    constexpr auto D = Impl::kDimensions;
+    constexpr auto levels = Impl::kMaxLevels;
+    static_assert(levels * D > 32 || D == 5, "64 bit ids should encode more levels");
+
+    std::default_random_engine prng(1 + D);
+    std::uniform_int_distribution<uint64_t> distr(0, (levels == 64 ? 0 : (uint64_t{1} << levels)) - 1);
+
+    for(int i=0; i < 10000; i++) {
+        std::array<uint64_t, D> coord;
+        for(auto& x : coord)
+            x = distr(prng);
+
+        const auto cell = Impl::deposit(coord);
+        ASSERT_EQ(cell, ReferenceDeposite64<D>(coord, levels)) << coord;
+        ASSERT_EQ(Impl::extract(cell), coord) << cell;
+    }
+}
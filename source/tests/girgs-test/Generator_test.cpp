@@ -2,10 +2,17 @@
 #include <algorithm>
 #include <cmath>
 #include <numeric>
+#include <mutex>
 
 #include <gmock/gmock.h>
 
+#include <omp.h>
+
 #include <girgs/Generator.h>
+#include <girgs/BatchedEdgeCallback.h>
+#include <girgs/EdgeBlocks.h>
+#include <girgs/GraphStatistics.h>
+#include <girgs/SpatialTree.h>
 
 using namespace std;
 
@@ -97,6 +104,77 @@ TEST_F(Generator_test, testGeneralModel)
 }
 
 
+// exposes SpatialTree::connected() with the exponent that the samplers pass for alpha
+template <unsigned int D>
+class ConnectedProbe : public girgs::SpatialTree<D, void(*)(int, int, int)> {
+public:
+    using Base = girgs::SpatialTree<D, void(*)(int, int, int)>;
+    ConnectedProbe(const vector<double>& weights, const vector<vector<double>>& positions, double alpha, void(*&callback)(int, int, int))
+        : Base(weights, positions, alpha, callback), m_alpha(alpha) {}
+
+    bool decide(double w_term, double d_term, double rnd) const {
+        if (m_alpha == 2) return this->template connected<2>(w_term, d_term, rnd);
+        if (m_alpha == 3) return this->template connected<3>(w_term, d_term, rnd);
+        if (m_alpha == 6) return this->template connected<6>(w_term, d_term, rnd);
+        return this->template connected<0>(w_term, d_term, rnd);
+    }
+
+private:
+    double m_alpha;
+};
+
+static void ignoreEdge(int, int, int) {}
+
+TEST_F(Generator_test, testIntegerPowerBounds)
+{
+    const auto n = 1000;
+    const auto d = 1u;
+    const auto ple = 2.5;
+
+    auto weights = girgs::generateWeights(n, ple, seed);
+    auto positions = girgs::generatePositions(n, d, seed);
+    auto W = accumulate(weights.begin(), weights.end(), 0.0);
+    auto callback = &ignoreEdge;
+
+    // integral alphas with and without a compile time exponent, fractional ones, and ones too large for integer powers
+    for (auto alpha : {2.0, 3.0, 6.0, 7.0, 1.3, 2.5, 1000.0, 1023.0, 1023.5, 1025.0, 2000.0}) {
+        ConnectedProbe<d> tree(weights, positions, alpha, callback);
+        std::mt19937_64 gen(seed);
+        std::uniform_real_distribution<double> dist;
+
+        auto edges = 0;
+        auto expected = 0;
+        for (int j = 0; j < n; ++j) {
+            for (int i = j + 1; i < n; ++i) {
+                const auto d_term = pow(distance(positions[i], positions[j]), d);
+                const auto w_term = weights[i] * weights[j] / W;
+                const auto rnd = dist(gen);
+                const auto x = w_term / d_term;
+                const auto edge = tree.decide(w_term, d_term, rnd);
+                const auto expected_edge = !(x < 1.0) || rnd < std::pow(x, alpha);
+                ASSERT_EQ(edge, expected_edge) << "alpha = " << alpha << ", x = " << x << ", rnd = " << rnd;
+                edges += edge;
+                expected += expected_edge;
+            }
+        }
+        ASSERT_EQ(edges, expected) << "alpha = " << alpha;
+    }
+
+    // end to end: the graphs approach the threshold model for large alpha
+    {
+        const auto n = 20000;
+        const auto deg = 10;
+        auto weights = girgs::generateWeights(n, ple, seed);
+        auto positions = girgs::generatePositions(n, d, seed);
+        girgs::scaleWeights(weights, deg, d, std::numeric_limits<double>::infinity());
+        const auto threshold_edges = static_cast<double>(girgs::generateEdges(weights, positions, std::numeric_limits<double>::infinity(), seed).size());
+        for (auto alpha : {1023.0, 1025.0, 2000.0}) {
+            const auto edges = static_cast<double>(girgs::generateEdges(weights, positions, alpha, seed).size());
+            EXPECT_NEAR(edges, threshold_edges, 0.05 * threshold_edges) << "alpha = " << alpha;
+        }
+    }
+}
+
 TEST_F(Generator_test, testCompleteGraph)
 {
     const auto n = 100;
@@ -269,7 +347,374 @@ TEST_F(Generator_test, testReproducible)
                     alpha, weight_seed+position_seed);
 
             // same edges
+            sort(edges1.begin(), edges1.end());
+            sort(edges2.begin(), edges2.end());
             EXPECT_EQ(edges1, edges2);
         }
     }
 }
+
+
+TEST_F(Generator_test, testEdgeCallback)
+{
+    auto n = 1000;
+    auto ple = 2.4;
+    auto alphas = { 1.5, std::numeric_limits<double>::infinity() };
+
+    auto weights = girgs::generateWeights(n, ple, seed);
+
+    for (auto alpha : alphas) {
+        for (auto d = 1u; d < 4; ++d) {
+            auto positions = girgs::generatePositions(n, d, seed+d);
+
+            // collect edges via the streaming interface
+            auto streamed = vector<pair<int, int>>();
+            std::mutex m;
+            auto batch = [&] (const pair<int, int>* begin, const pair<int, int>* end, int) {
+                std::lock_guard<std::mutex> lock(m);
+                streamed.insert(streamed.end(), begin, end);
+            };
+            auto callback = girgs::makeBatchedEdgeCallback(batch, 16);
+            girgs::generateEdges(weights, positions, alpha, seed, callback);
+            callback.flush();
+
+            auto collected = girgs::generateEdges(weights, positions, alpha, seed);
+
+            sort(streamed.begin(), streamed.end());
+            sort(collected.begin(), collected.end());
+            EXPECT_EQ(streamed, collected);
+        }
+    }
+}
+
+TEST_F(Generator_test, testEdgeBlocks)
+{
+    const auto n = 2000;
+    const auto alpha = 2.5;
+    const auto max_threads = omp_get_max_threads();
+
+    auto weights = girgs::generateWeights(n, 2.5, seed);
+    auto positions = girgs::generatePositions(n, 2, seed+1);
+    girgs::scaleWeights(weights, 10, 2, alpha);
+    auto expected = girgs::generateEdges(weights, positions, alpha, seed+2);
+    sort(expected.begin(), expected.end());
+
+    for (auto threads : {1, 3}) {
+        omp_set_num_threads(threads);
+
+        // tiny blocks to get many of them per thread
+        auto blocks = girgs::EdgeBlocks<int>(7);
+        girgs::generateEdges(weights, positions, alpha, seed+2, blocks);
+        ASSERT_EQ(blocks.size(), expected.size());
+
+        auto concatenated = vector<pair<int, int>>();
+        for (auto& segment : blocks.segments()) {
+            EXPECT_LE(segment.second - segment.first, 7);
+            concatenated.insert(concatenated.end(), segment.first, segment.second);
+        }
+
+        auto merged = blocks.merge();
+        EXPECT_EQ(merged, concatenated); // same order
+        EXPECT_EQ(blocks.size(), 0u);
+
+        sort(merged.begin(), merged.end());
+        EXPECT_EQ(merged, expected) << "threads = " << threads;
+    }
+
+    omp_set_num_threads(max_threads);
+}
+
+
+TEST_F(Generator_test, testThreadIndependence)
+{
+    auto n = 5000;
+    auto ple = 2.2;
+    auto alphas = { 1.5, std::numeric_limits<double>::infinity() };
+    auto dimensions = { 1, 2, 3 };
+
+    const auto max_threads = omp_get_max_threads();
+
+    auto generate = [&] (int threads, double alpha, int d) {
+        omp_set_num_threads(threads);
+        auto weights = girgs::generateWeights(n, ple, seed);
+        auto positions = girgs::generatePositions(n, d, seed+1);
+        girgs::scaleWeights(weights, 10, d, alpha);
+        auto edges = girgs::generateEdges(weights, positions, alpha, seed+2);
+        sort(edges.begin(), edges.end());
+        return edges;
+    };
+
+    for (auto alpha : alphas) {
+        for (auto d : dimensions) {
+            auto sequential = generate(1, alpha, d);
+            for (auto threads : {2, 3}) {
+                EXPECT_EQ(sequential, generate(threads, alpha, d)) << "threads = " << threads;
+            }
+        }
+    }
+
+    omp_set_num_threads(max_threads);
+}
+
+TEST_F(Generator_test, testGraphStatistics)
+{
+    const auto n = 2000;
+    const auto max_threads = omp_get_max_threads();
+
+    for (auto alpha : {std::numeric_limits<double>::infinity(), 1.5}) {
+        auto weights = girgs::generateWeights(n, 2.2, seed);
+        auto positions = girgs::generatePositions(n, 2, seed+1);
+        girgs::scaleWeights(weights, 10, 2, alpha);
+        const auto edges = girgs::generateEdges(weights, positions, alpha, seed+2);
+
+        auto degrees = vector<unsigned>(n, 0);
+        for (auto& e : edges) {
+            ++degrees[e.first];
+            ++degrees[e.second];
+        }
+        const auto max_degree = *max_element(degrees.begin(), degrees.end());
+        auto histogram = vector<uint64_t>(max_degree + 1, 0);
+        for (auto degree : degrees)
+            ++histogram[degree];
+
+        for (auto threads : {1, 3}) {
+            omp_set_num_threads(threads);
+
+            girgs::GraphStatistics<int> statistics(n);
+            girgs::generateEdges(weights, positions, alpha, seed+2, statistics);
+            statistics.finalize();
+            EXPECT_EQ(statistics.numEdges(), edges.size());
+            EXPECT_EQ(statistics.degrees(), degrees);
+            EXPECT_EQ(statistics.histogram(), histogram);
+            EXPECT_EQ(statistics.maxDegree(), max_degree);
+            EXPECT_DOUBLE_EQ(statistics.averageDegree(), 2.0 * edges.size() / n);
+
+            girgs::EdgeCounter counter;
+            girgs::generateEdges(weights, positions, alpha, seed+2, counter);
+            EXPECT_EQ(counter.numEdges(), edges.size()) << "threads = " << threads;
+        }
+    }
+
+    omp_set_num_threads(max_threads);
+}
+
+
+template <unsigned int D, typename CellId>
+static vector<pair<int, int>> generateWithCellIds(const vector<double>& weights, const vector<vector<double>>& positions, double alpha, int seed) {
+    auto edges = vector<pair<int, int>>();
+    std::mutex m;
+    auto addEdge = [&] (int u, int v, int) {
+        std::lock_guard<std::mutex> lock(m);
+        edges.emplace_back(u, v);
+    };
+    girgs::makeSpatialTree<D, girgs::SplitMix64, CellId>(weights, positions, alpha, addEdge).generateEdges(seed);
+    sort(edges.begin(), edges.end());
+    return edges;
+}
+
+template <unsigned int D>
+static void compareCellIdTypes(int n, int seed) {
+    auto weights = girgs::generateWeights(n, 2.5, seed);
+    auto positions = girgs::generatePositions(n, D, seed+1);
+    for (auto alpha : {1.5, std::numeric_limits<double>::infinity()}) {
+        auto narrow = generateWithCellIds<D, uint32_t>(weights, positions, alpha, seed+2);
+        auto wide   = generateWithCellIds<D, uint64_t>(weights, positions, alpha, seed+2);
+        EXPECT_FALSE(narrow.empty());
+        EXPECT_EQ(narrow, wide) << "D = " << D << " alpha = " << alpha;
+    }
+}
+
+TEST_F(Generator_test, testCellIdTypes)
+{
+    // both cell id types use the same cell numbering and random streams, hence produce the same graph
+    compareCellIdTypes<1>(3000, seed);
+    compareCellIdTypes<2>(3000, seed);
+    compareCellIdTypes<3>(3000, seed);
+    compareCellIdTypes<4>(3000, seed);
+    compareCellIdTypes<5>(3000, seed);
+
+    // 32 bit cell ids limit the depth of the tree in high dimensions
+    EXPECT_EQ((girgs::SpatialTreeCoordinateHelper<5, uint32_t>::maxLevels()), 6);
+    EXPECT_GT((girgs::SpatialTreeCoordinateHelper<5, uint64_t>::maxLevels()), 6);
+}
+
+TEST_F(Generator_test, testNodeIdTypes)
+{
+    // the node id type only affects the representation of the graph, not the sampled edges
+    const auto n = 2000;
+    for (auto d : {1, 3}) {
+        for (auto alpha : {std::numeric_limits<double>::infinity(), 2.5}) {
+            auto weights = girgs::generateWeights(n, 2.8, seed);
+            auto positions = girgs::generatePositions(n, d, seed + 1);
+            girgs::scaleWeights(weights, 10, d, alpha);
+
+            auto narrow = girgs::generateEdges(weights, positions, alpha, seed + 2);
+            auto wide = girgs::generateEdges64(weights, positions, alpha, seed + 2);
+            ASSERT_EQ(narrow.size(), wide.size());
+
+            auto widened = std::vector<std::pair<int64_t, int64_t>>(narrow.begin(), narrow.end());
+            std::sort(widened.begin(), widened.end());
+            std::sort(wide.begin(), wide.end());
+            EXPECT_EQ(widened, wide) << "d = " << d << " alpha = " << alpha;
+        }
+    }
+}
+
+TEST_F(Generator_test, testFlatPositions)
+{
+    // a caller owned buffer with padding between nodes yields the same positions and edges
+    const auto n = 2000;
+    for (auto d : {1, 2, 4}) {
+        const auto stride = static_cast<size_t>(d + 1);
+        auto positions = girgs::generatePositions(n, d, seed);
+        auto flat = std::vector<double>(n * stride, -1.0);
+        girgs::generatePositions(n, d, seed, flat.data(), stride);
+        for (auto i = 0; i < n; ++i) {
+            for (auto k = 0; k < d; ++k)
+                ASSERT_EQ(positions[i][k], flat[i * stride + k]);
+            ASSERT_EQ(flat[i * stride + d], -1.0); // padding is not touched
+        }
+
+        for (auto alpha : {std::numeric_limits<double>::infinity(), 2.5}) {
+            auto weights = girgs::generateWeights(n, 2.8, seed + 1);
+            girgs::scaleWeights(weights, 10, d, alpha);
+
+            auto edges = girgs::generateEdges(weights, positions, alpha, seed + 2);
+            auto flat_edges = girgs::generateEdges(weights, flat.data(), d, stride, alpha, seed + 2);
+            std::sort(edges.begin(), edges.end());
+            std::sort(flat_edges.begin(), flat_edges.end());
+            EXPECT_EQ(edges, flat_edges) << "d = " << d << " alpha = " << alpha;
+        }
+    }
+}
+
+TEST_F(Generator_test, testPresortedPositions)
+{
+    const auto n = 3000;
+    const auto max_threads = omp_get_max_threads();
+
+    // the nodes are in a different order within the cells, so edges may be reported in the other direction
+    auto normalized = [] (vector<pair<int, int>> edges) -> vector<pair<int, int>> {
+        for (auto& e : edges)
+            if (e.first > e.second)
+                swap(e.first, e.second);
+        sort(edges.begin(), edges.end());
+        return edges;
+    };
+
+    for (auto d : {1, 2, 3}) {
+        for (auto alpha : {std::numeric_limits<double>::infinity(), 2.5}) {
+            auto weights = girgs::generateWeights(n, 2.5, seed);
+            girgs::scaleWeights(weights, 10, d, alpha);
+
+            auto reference = vector<double>();
+            auto reference_edges = vector<pair<int, int>>();
+            for (auto threads : {1, 3}) {
+                omp_set_num_threads(threads);
+
+                auto positions = vector<double>(n * d, -1.0);
+                girgs::EdgeBlocks<int> blocks;
+                girgs::generatePositionsAndEdges(weights, d, seed + 1, alpha, seed + 2, blocks, positions.data());
+                const auto edges = normalized(blocks.merge());
+
+                for (auto x : positions) {
+                    ASSERT_GE(x, 0.0);
+                    ASSERT_LT(x, 1.0);
+                }
+
+                // positions and edges do not depend on the number of threads
+                if (reference.empty()) {
+                    reference = positions;
+                    reference_edges = edges;
+                } else {
+                    EXPECT_EQ(reference, positions) << "d = " << d << " alpha = " << alpha;
+                    EXPECT_EQ(reference_edges, edges) << "d = " << d << " alpha = " << alpha;
+                }
+
+                // in the threshold model the edges are determined by the positions, no matter how the tree was built
+                if (alpha == std::numeric_limits<double>::infinity()) {
+                    const auto expected = girgs::generateEdges(weights, positions.data(), d, d, alpha, seed + 2);
+                    EXPECT_EQ(normalized(expected), edges) << "d = " << d;
+                }
+            }
+        }
+    }
+
+    omp_set_num_threads(max_threads);
+
+    // the positions are uniform and independent of the weights, even if the heavy nodes come last
+    const auto d = 2;
+    auto weights = girgs::generateWeights(n, 2.5, seed);
+    sort(weights.begin(), weights.end());
+    auto positions = vector<double>(n * d);
+    auto count = [] (int, int, int) {};
+    girgs::generatePositionsAndEdges(weights, d, seed + 1, 2.5, seed + 2, count, positions.data());
+
+    const auto sigma = std::sqrt(n / 4.0); // of the number of nodes in one half of the torus
+    for (auto k = 0; k < d; ++k) {
+        auto lower = 0;
+        auto lower_heavy = 0;
+        for (auto i = 0; i < n; ++i) {
+            lower += positions[i * d + k] < 0.5;
+            lower_heavy += i >= n / 2 && positions[i * d + k] < 0.5;
+        }
+        EXPECT_NEAR(lower, n / 2, 4 * sigma);
+        EXPECT_NEAR(lower_heavy, n / 4, 4 * sigma);
+    }
+}
+
+// neighbors of each node in ascending order; both directions if symmetric, only u < v otherwise
+template <typename NodeId>
+static vector<vector<NodeId>> adjacencyLists(const vector<pair<NodeId, NodeId>>& edges, size_t n, bool symmetric) {
+    auto lists = vector<vector<NodeId>>(n);
+    for (auto& e : edges) {
+        lists[min(e.first, e.second)].push_back(max(e.first, e.second));
+        if (symmetric)
+            lists[max(e.first, e.second)].push_back(min(e.first, e.second));
+    }
+    for (auto& each : lists)
+        sort(each.begin(), each.end());
+    return lists;
+}
+
+template <typename NodeId>
+static vector<vector<NodeId>> adjacencyLists(const girgs::CSRGraph<NodeId>& csr) {
+    auto lists = vector<vector<NodeId>>(csr.offsets.size() - 1);
+    for (size_t u = 0; u < lists.size(); ++u)
+        lists[u].assign(csr.neighbors.begin() + csr.offsets[u], csr.neighbors.begin() + csr.offsets[u + 1]);
+    return lists;
+}
+
+TEST_F(Generator_test, testCSR)
+{
+    const auto n = 2000;
+    const auto d = 2;
+    const auto max_threads = omp_get_max_threads();
+
+    for (auto alpha : {std::numeric_limits<double>::infinity(), 2.5}) {
+        auto weights = girgs::generateWeights(n, 2.5, seed);
+        auto positions = girgs::generatePositions(n, d, seed + 1);
+        girgs::scaleWeights(weights, 10, d, alpha);
+        const auto edges = girgs::generateEdges(weights, positions, alpha, seed + 2);
+
+        for (auto threads : {1, 3}) {
+            omp_set_num_threads(threads);
+            for (auto symmetric : {true, false}) {
+                const auto csr = girgs::generateCSR(weights, positions, alpha, seed + 2, symmetric);
+                ASSERT_EQ(csr.offsets.size(), n + 1u);
+                EXPECT_EQ(csr.offsets.front(), 0u);
+                EXPECT_EQ(csr.neighbors.size(), (symmetric ? 2 : 1) * edges.size());
+                EXPECT_EQ(adjacencyLists(csr), adjacencyLists(edges, n, symmetric))
+                    << "alpha = " << alpha << " threads = " << threads << " symmetric = " << symmetric;
+            }
+
+            auto flat = vector<double>(n * d);
+            girgs::generatePositions(n, d, seed + 1, flat.data(), d);
+            const auto csr64 = girgs::generateCSR64(weights, flat.data(), d, d, alpha, seed + 2);
+            const auto edges64 = vector<pair<int64_t, int64_t>>(edges.begin(), edges.end());
+            EXPECT_EQ(adjacencyLists(csr64), adjacencyLists(edges64, n, true));
+        }
+    }
+
+    omp_set_num_threads(max_threads);
+}
@@ -37,3 +37,19 @@ TYPED_TEST(Pow_test, CrossTest) {
         ASSERT_NEAR(tested, ref, fabs(ref * 1e-15));
     }
 }
+
+TYPED_TEST(Pow_test, RuntimeExponent) {
+    static constexpr std::size_t D = TypeParam::value;
+
+    std::mt19937_64 prng(D);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    for(int i=0; i < 100000; ++i) {
+        const auto x = dist(prng);
+        const auto ref = girgs::pow_to_the<D>(x);
+        const auto tested = girgs::pow_int(x, D);
+
+        ASSERT_NEAR(tested, ref, fabs(ref * 1e-15));
+        ASSERT_NEAR(tested, std::pow(x, D), fabs(ref * 1e-14));
+    }
+}
@@ -0,0 +1,89 @@
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <girgs/Random.h>
+
+template <typename T>
+class EngineTest : public ::testing::Test {};
+
+using Engines = ::testing::Types<
+    girgs::SplitMix64,
+    girgs::Xoshiro256PlusPlus,
+    girgs::Philox4x32
+>;
+
+TYPED_TEST_CASE(EngineTest, Engines);
+
+TYPED_TEST(EngineTest, KeyDeterminesStream) {
+    TypeParam gen1(42), gen2(42), gen3(43);
+
+    auto differences = 0;
+    for (int i = 0; i < 1000; ++i) {
+        const auto x = gen1();
+        EXPECT_EQ(x, gen2());
+        differences += (x != gen3());
+    }
+    EXPECT_EQ(differences, 1000);
+
+    gen1.seed(43);
+    TypeParam gen4(43);
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(gen1(), gen4());
+}
+
+TYPED_TEST(EngineTest, BitBalance) {
+    TypeParam gen(1);
+    constexpr auto samples = 100000;
+
+    std::vector<int> ones(64, 0);
+    for (int i = 0; i < samples; ++i) {
+        const auto x = gen();
+        for (int b = 0; b < 64; ++b)
+            ones[b] += (x >> b) & 1;
+    }
+
+    // 6 sigma
+    for (int b = 0; b < 64; ++b)
+        EXPECT_NEAR(ones[b], samples / 2, 6 * std::sqrt(samples / 4.0)) << "bit " << b;
+}
+
+TYPED_TEST(EngineTest, FastUniform) {
+    TypeParam gen(2);
+    girgs::FastUniformRealDistribution dist(-1.0, 3.0);
+    constexpr auto samples = 100000;
+
+    auto sum = 0.0;
+    for (int i = 0; i < samples; ++i) {
+        const auto x = dist(gen);
+        ASSERT_GE(x, -1.0);
+        ASSERT_LT(x, 3.0);
+        sum += x;
+    }
+
+    // variance of U(-1,3) is 16/12
+    EXPECT_NEAR(sum / samples, 1.0, 6 * std::sqrt(16.0 / 12.0 / samples));
+}
+
+TYPED_TEST(EngineTest, FastGeometric) {
+    TypeParam gen(3);
+    constexpr auto samples = 100000;
+
+    for (auto p : {1e-3, 0.1, 0.5, 1.0}) {
+        girgs::FastGeometricDistribution geo(p);
+
+        auto sum = 0.0;
+        for (int i = 0; i < samples; ++i)
+            sum += geo(gen);
+
+        // mean (1-p)/p and variance (1-p)/p^2
+        EXPECT_NEAR(sum / samples, (1 - p) / p, 6 * std::sqrt((1 - p) / p / p / samples) + 1e-9) << "p = " << p;
+    }
+}
+
+TEST(Philox4x32, KnownAnswer) {
+    // Random123 known answer test: philox4x32_10 with zero counter and key
+    girgs::Philox4x32 gen(0);
+    EXPECT_EQ(gen(), 0xe169c58d6627e8d5ull);
+    EXPECT_EQ(gen(), 0x9b00dbd8bc57ac4cull);
+}
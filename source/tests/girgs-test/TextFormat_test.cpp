@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <omp.h>
+
+#include <gtest/gtest.h>
+#include <girgs/TextFormat.h>
+
+
+class TextFormat_test : public ::testing::Test {
+protected:
+    void TearDown() override {
+        std::remove(file.c_str());
+    }
+
+    std::string readFile() const {
+        std::ifstream f(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+
+    // the edge list as the CLIs used to write it
+    template <typename NodeId>
+    static std::string expectedEdgeList(const std::vector<std::pair<NodeId, NodeId>>& edges, long long n) {
+        std::ostringstream ss;
+        ss << n << ' ' << edges.size() << "\n\n";
+        for (auto& each : edges)
+            ss << each.first << ' ' << each.second << '\n';
+        return ss.str();
+    }
+
+    const std::string file = "text_format_test.txt";
+};
+
+
+TEST_F(TextFormat_test, edgeListMatchesStream) {
+    // more edges than fit into one chunk per thread
+    const auto n = 1000000;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, n-1);
+    std::vector<std::pair<int, int>> edges(300000);
+    for (auto& each : edges)
+        each = {dist(gen), dist(gen)};
+    edges.emplace_back(0, 9);
+    edges.emplace_back(10, 99);
+    edges.emplace_back(100, std::numeric_limits<int>::max());
+
+    const auto expected = expectedEdgeList(edges, n);
+    const auto maxThreads = omp_get_max_threads();
+    for (int threads = 1; threads <= 4; ++threads) {
+        omp_set_num_threads(threads);
+        girgs::saveEdgeList(edges, n, file);
+        EXPECT_EQ(readFile(), expected) << "threads = " << threads;
+    }
+    omp_set_num_threads(maxThreads);
+}
+
+TEST_F(TextFormat_test, edgeList64MatchesStream) {
+    const std::vector<std::pair<int64_t, int64_t>> edges = {
+        {0, 1}, {-1, -10}, {(1ll << 40) + 7, 123456789012345ll},
+        {std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min()}};
+
+    girgs::saveEdgeList(edges, 1ll << 41, file);
+    EXPECT_EQ(readFile(), expectedEdgeList(edges, 1ll << 41));
+
+    girgs::saveEdgeList(std::vector<std::pair<int64_t, int64_t>>(), 5, file);
+    EXPECT_EQ(readFile(), "5 0\n\n");
+}
+
+TEST_F(TextFormat_test, columnsMatchStream) {
+    const auto n = 100000;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(0, 30);
+    std::vector<double> radii(n), angles(n);
+    for (int i = 0; i < n; ++i) {
+        radii[i] = dist(gen);
+        angles[i] = dist(gen) / 5;
+    }
+    radii[0] = 0.0;
+    radii[1] = 1e300;
+    angles[1] = -0.0000004999;
+    angles[2] = 2.0000005;
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(6);
+    for (int i = 0; i < n; ++i)
+        ss << radii[i] << ' ' << angles[i] << '\n';
+
+    girgs::saveColumns({radii.data(), angles.data()}, n, file);
+    EXPECT_EQ(readFile(), ss.str());
+}
+
+TEST_F(TextFormat_test, throwsIfFileCannotBeOpened) {
+    EXPECT_THROW(girgs::saveEdgeList(std::vector<std::pair<int, int>>(), 1, "does/not/exist.txt"), std::runtime_error);
+}
@@ -1,9 +1,13 @@
 #include <algorithm>
 #include <cmath>
 #include <numeric>
+#include <random>
 
 #include <gmock/gmock.h>
 
+#include <omp.h>
+
+#include <hypergirgs/DistanceFilter.h>
 #include <hypergirgs/HyperbolicTree.h>
 #include <hypergirgs/Generator.h>
 
@@ -123,3 +127,352 @@ TEST_F(HyperbolicTree_test, testReproducible)
         ASSERT_EQ(edges1, edges2);
     }
 }
+
+
+TEST_F(HyperbolicTree_test, testThreadIndependence)
+{
+    const auto n = 20000;
+    const auto alpha = 0.75; // ple = 2*alpha+1
+    const auto deg = 10;
+    const auto max_threads = omp_get_max_threads();
+
+    for (auto T : {0.0, 0.5}) {
+        auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+        auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+        auto angles = hypergirgs::sampleAngles(n, angleSeed);
+
+        // the random streams only depend on the seed, so the graph is the same for any number of threads
+        vector<pair<int, int>> expected;
+        for (auto threads : {1, 2, 3, 8, 13}) {
+            omp_set_num_threads(threads);
+            auto edges = hypergirgs::generateEdges(radii, angles, T, R, edgesSeed);
+            for (auto& e : edges)
+                if (e.first > e.second)
+                    swap(e.first, e.second);
+            sort(edges.begin(), edges.end());
+
+            if (threads == 1)
+                expected = edges;
+            else
+                ASSERT_EQ(edges, expected) << "T = " << T << ", threads = " << threads;
+        }
+        omp_set_num_threads(max_threads);
+    }
+}
+
+
+TEST_F(HyperbolicTree_test, testDecomposition)
+{
+    const auto n = 20000;
+    const auto alpha = 0.55; // skewed inner disk
+    const auto deg = 50;
+
+    for (auto T : {0.0, 0.5}) {
+        auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+        auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+        auto angles = hypergirgs::sampleAngles(n, angleSeed);
+        auto expected = hypergirgs::generateEdges(radii, angles, T, R, edgesSeed);
+        for (auto& e : expected)
+            if (e.first > e.second)
+                swap(e.first, e.second);
+        sort(expected.begin(), expected.end());
+
+        vector<pair<int, int>> edges;
+        auto callback = [&edges] (int u, int v, int) { edges.emplace_back(min(u, v), max(u, v)); };
+        auto tree = makeHyperbolicTree(radii, angles, T, R, callback);
+
+        auto num_tasks = size_t{0};
+        for (auto threads : {2, 16, 128}) {
+            auto tasks = tree.decompose(threads);
+            ASSERT_GT(tasks.size(), num_tasks);
+            num_tasks = tasks.size();
+            ASSERT_TRUE(is_sorted(tasks.begin(), tasks.end(), [] (const TaskDescription& a, const TaskDescription& b) {
+                return a.cost > b.cost; }));
+
+            // the tasks cover all samples once, in any order
+            edges.clear();
+            for (auto it = tasks.rbegin(); it != tasks.rend(); ++it)
+                tree.sampleTask(*it, edgesSeed);
+            sort(edges.begin(), edges.end());
+            ASSERT_EQ(edges, expected) << "T = " << T << ", threads = " << threads;
+        }
+    }
+}
+
+
+TEST_F(HyperbolicTree_test, testNodeIdTypes)
+{
+    const auto n = 1000;
+    const auto alpha = 0.75; // ple = 2*alpha+1
+    const auto Ts = {0.0, 0.5};
+    const auto deg = 10;
+
+    for(auto T : Ts) {
+        auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+        auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+        auto angles = hypergirgs::sampleAngles(n, angleSeed);
+        auto edges = hypergirgs::generateEdges(radii, angles, T, R, edgesSeed);
+        auto edges64 = hypergirgs::generateEdges64(radii, angles, T, R, edgesSeed);
+
+        auto widened = vector<pair<int64_t, int64_t>>(edges.begin(), edges.end());
+        sort(widened.begin(), widened.end());
+        sort(edges64.begin(), edges64.end());
+        ASSERT_EQ(widened, edges64);
+    }
+}
+
+
+TEST_F(HyperbolicTree_test, testCSR)
+{
+    const auto n = 2000;
+    const auto alpha = 0.75; // ple = 2*alpha+1
+    const auto Ts = {0.0, 0.5};
+    const auto deg = 10;
+    const auto max_threads = omp_get_max_threads();
+
+    for(auto T : Ts) {
+        auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+        auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+        auto angles = hypergirgs::sampleAngles(n, angleSeed);
+
+        for (auto threads : {1, 3}) {
+            omp_set_num_threads(threads);
+            // the edges only depend on the seed for a fixed number of threads
+            auto edges = hypergirgs::generateEdges64(radii, angles, T, R, edgesSeed);
+
+            for (auto symmetric : {true, false}) {
+                auto expected = vector<vector<int64_t>>(n);
+                for (auto& e : edges) {
+                    expected[min(e.first, e.second)].push_back(max(e.first, e.second));
+                    if (symmetric)
+                        expected[max(e.first, e.second)].push_back(min(e.first, e.second));
+                }
+                for (auto& each : expected)
+                    sort(each.begin(), each.end());
+
+                auto csr = hypergirgs::generateCSR64(radii, angles, T, R, edgesSeed, symmetric);
+                ASSERT_EQ(csr.offsets.size(), n + 1u);
+                ASSERT_EQ(csr.neighbors.size(), (symmetric ? 2 : 1) * edges.size());
+                for (auto u = 0; u < n; ++u) {
+                    auto actual = vector<int64_t>(csr.neighbors.begin() + csr.offsets[u], csr.neighbors.begin() + csr.offsets[u + 1]);
+                    ASSERT_EQ(actual, expected[u]) << "T = " << T << " threads = " << threads << " u = " << u;
+                }
+
+                auto csr32 = hypergirgs::generateCSR(radii, angles, T, R, edgesSeed, symmetric);
+                EXPECT_EQ(csr32.offsets, csr.offsets);
+                EXPECT_TRUE(equal(csr.neighbors.begin(), csr.neighbors.end(), csr32.neighbors.begin()));
+            }
+        }
+    }
+
+    omp_set_num_threads(max_threads);
+}
+
+TEST_F(HyperbolicTree_test, testPresortedPositions)
+{
+    const auto n = 20000;
+    const auto alpha = 0.75; // ple = 2*alpha+1
+    const auto deg = 10;
+    const auto max_threads = omp_get_max_threads();
+
+    for (auto T : {0.0, 0.5}) {
+        const auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+
+        // the points only depend on the seed and not on the number of threads
+        auto radii = vector<double>(n);
+        auto angles = vector<double>(n);
+        vector<pair<int, int>> edges;
+        for (auto threads : {1, 3}) {
+            omp_set_num_threads(threads);
+            auto radii_t = vector<double>(n, -1.0);
+            auto angles_t = vector<double>(n, -1.0);
+            edges = hypergirgs::generatePositionsAndEdges(n, alpha, T, R, radiiSeed, edgesSeed, radii_t.data(), angles_t.data());
+            if (threads == 1) {
+                radii = radii_t;
+                angles = angles_t;
+            } else {
+                ASSERT_EQ(radii, radii_t) << "T = " << T;
+                ASSERT_EQ(angles, angles_t) << "T = " << T;
+            }
+        }
+        omp_set_num_threads(max_threads);
+
+        for (int i = 0; i < n; ++i) {
+            ASSERT_GT(radii[i], 0.0);
+            ASSERT_LT(radii[i], R);
+            ASSERT_GE(angles[i], 0.0);
+            ASSERT_LT(angles[i], 2*PI);
+        }
+
+        // the radial density is proportional to sinh(alpha*r), i.e. cosh(alpha*r) is uniform
+        const auto median = std::acosh(0.5 * (1.0 + std::cosh(alpha * R))) / alpha;
+        const auto below = count_if(radii.begin(), radii.end(), [median] (double r) { return r < median; });
+        EXPECT_NEAR(below, n / 2, 5 * std::sqrt(n));
+        const auto left = count_if(angles.begin(), angles.end(), [] (double a) { return a < PI; });
+        EXPECT_NEAR(left, n / 2, 5 * std::sqrt(n));
+
+        if (T == 0) {
+            // in the threshold model the graph is determined by the points
+            auto expected = hypergirgs::generateEdges(radii, angles, T, R, edgesSeed);
+            for (auto* list : {&edges, &expected}) {
+                for (auto& e : *list)
+                    if (e.first > e.second)
+                        swap(e.first, e.second);
+                sort(list->begin(), list->end());
+            }
+            ASSERT_EQ(edges, expected);
+        } else {
+            auto num_desired = 0.5*deg*n;
+            auto rigor = 0.8;
+            EXPECT_LE(rigor * edges.size(), num_desired);
+            EXPECT_LE(rigor * num_desired, edges.size());
+        }
+    }
+}
+
+TEST_F(HyperbolicTree_test, testAngularWindow)
+{
+    // dense graphs have many points per cell, s.t. type 1 checks search the angular window in B
+    const auto n = 4000;
+    const auto T = 0;
+
+    for (auto alpha : {0.55, 0.75, 1.5}) {
+        for (auto deg : {10, 200}) {
+            auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+            auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+            auto angles = hypergirgs::sampleAngles(n, angleSeed);
+            auto edges = hypergirgs::generateEdges(radii, angles, T, R, edgesSeed);
+            for (auto& e : edges)
+                if (e.first > e.second)
+                    swap(e.first, e.second);
+            sort(edges.begin(), edges.end());
+
+            // all pairs with the same test as the tree
+            auto points = vector<Point<int>>();
+            for (int i = 0; i < n; ++i)
+                points.emplace_back(i, radii[i], angles[i]);
+            const auto coshR = std::cosh(R);
+            auto expected = vector<pair<int, int>>();
+            for (int i = 0; i < n; ++i)
+                for (int j = i + 1; j < n; ++j)
+                    if (points[i].isDistanceBelowR(points[j], coshR))
+                        expected.emplace_back(i, j);
+
+            ASSERT_EQ(edges, expected) << "alpha = " << alpha << ", deg = " << deg;
+        }
+    }
+}
+
+TEST_F(HyperbolicTree_test, testDistanceFilter)
+{
+    const auto R = 20.0;
+    auto gen = mt19937_64(edgesSeed);
+    auto dist = uniform_real_distribution<>(0.0, 2 * R);
+    auto prob = uniform_real_distribution<>();
+
+    for (auto T : {0.1, 0.5, 0.9}) {
+        for (auto max_prob : {1.0, 0.2, 1e-5}) {
+            for (auto stages : {32u, 1024u}) {
+                const DistanceFilter filter(max_prob, R, T, stages);
+                ASSERT_EQ(filter.stages(), stages);
+
+                for (int k = 0; k < 10000; ++k) {
+                    const auto d = dist(gen);
+                    const auto p = max_prob * prob(gen);
+                    const auto conn_prob = 1.0 / (1.0 + std::exp(0.5 / T * (d - R)));
+                    if (std::cosh(d) > filter.coshDistForProb_upperBound(p))
+                        ASSERT_LE(conn_prob, p);
+                    if (std::cosh(d) < filter.coshDistForProb_lowerBound(p))
+                        ASSERT_GE(conn_prob, p);
+                }
+            }
+        }
+    }
+
+    // the filter only holds the range
+    const DistanceFilter range_only(0.5, R, 0.5, 0);
+    ASSERT_EQ(range_only.stages(), 0);
+    ASSERT_EQ(range_only.max_connection_prob, 0.5);
+}
+
+TEST_F(HyperbolicTree_test, testFilterFallbacks)
+{
+    const auto n = 10000;
+    const auto alpha = 0.75;
+    const auto deg = 10;
+
+    for (auto T : {0.1, 0.5, 0.9}) {
+        auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+        auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+        auto angles = hypergirgs::sampleAngles(n, angleSeed);
+        auto addEdge = [](int, int, int) {};
+
+        // only counted with profiling
+        auto generator = hypergirgs::makeHyperbolicTree(radii, angles, T, R, addEdge);
+        generator.generate(edgesSeed);
+        ASSERT_EQ(generator.filterChecks(), 0);
+
+        auto profiled = hypergirgs::makeHyperbolicTree(radii, angles, T, R, addEdge, true);
+        profiled.generate(edgesSeed);
+        ASSERT_GT(profiled.filterChecks(), 0) << "T = " << T;
+        ASSERT_LE(profiled.filterFallbacks(), profiled.filterChecks() / 16) << "T = " << T;
+    }
+}
+
+TEST_F(HyperbolicTree_test, testLayerHeight)
+{
+    const auto alpha = 0.75; // ple = 2*alpha+1
+    const auto deg = 10;
+
+    for (auto T : {0.0, 0.5}) {
+        // for T > 0 the number of edges only matches on average (see testGeneralModel)
+        const auto n = T ? 20000 : 4000;
+        auto R = hypergirgs::calculateRadius(n, alpha, T, deg);
+        auto radii = hypergirgs::sampleRadii(n, alpha, R, radiiSeed);
+        auto angles = hypergirgs::sampleAngles(n, angleSeed);
+
+        // all pairs with the same test as the tree
+        auto expected = vector<pair<int, int>>();
+        if (!T) {
+            auto points = vector<Point<int>>();
+            for (int i = 0; i < n; ++i)
+                points.emplace_back(i, radii[i], angles[i]);
+            const auto coshR = std::cosh(R);
+            for (int i = 0; i < n; ++i)
+                for (int j = i + 1; j < n; ++j)
+                    if (points[i].isDistanceBelowR(points[j], coshR))
+                        expected.emplace_back(i, j);
+        }
+
+        // 0 chooses the layer height automatically
+        for (auto layer_height : {0.5, 1.0, 2.5, 0.0}) {
+            auto edges_per_thread = vector<vector<pair<int, int>>>(omp_get_max_threads());
+            auto addEdge = [&edges_per_thread] (int u, int v, int tid) {
+                edges_per_thread[tid].emplace_back(min(u, v), max(u, v));
+            };
+            auto generator = hypergirgs::makeHyperbolicTree(radii, angles, T, R, addEdge, false, layer_height);
+            generator.generate(edgesSeed);
+
+            if (layer_height > 0) {
+                ASSERT_EQ(generator.layerHeight(), layer_height);
+            } else {
+                ASSERT_GE(generator.layerHeight(), 0.5);
+                ASSERT_LE(generator.layerHeight(), 4.0);
+            }
+
+            auto edges = vector<pair<int, int>>();
+            for (auto& list : edges_per_thread)
+                edges.insert(edges.end(), list.begin(), list.end());
+            sort(edges.begin(), edges.end());
+
+            if (!T) {
+                ASSERT_EQ(edges, expected) << "layer height = " << layer_height;
+            } else {
+                auto num_desired = 0.5*deg*n;
+                auto rigor = 0.8;
+                EXPECT_LE(rigor * edges.size(), num_desired) << "layer height = " << layer_height;
+                EXPECT_LE(rigor * num_desired, edges.size()) << "layer height = " << layer_height;
+            }
+        }
+    }
+}
@@ -1,7 +1,11 @@
+#include <cmath>
+#include <limits>
+#include <vector>
 
 #include <gmock/gmock.h>
 
 #include <hypergirgs/Point.h>
+#include <hypergirgs/BatchMath.h>
 #include <hypergirgs/Generator.h>
 #include <hypergirgs/AngleHelper.h>
 
@@ -21,7 +25,7 @@ protected:
             , points(n)
     {
         for (int i = 0; i < n; ++i) {
-            points[i] = Point(i, radii[i], angles[i], 0);
+            points[i] = Point<>(i, radii[i], angles[i], 0);
         }
     }
 
@@ -31,7 +35,7 @@ protected:
     double cosh_R;
     std::vector<double> angles;
     std::vector<double> radii;
-    std::vector<Point> points;
+    std::vector<Point<>> points;
 };
 
 
@@ -65,3 +69,55 @@ TEST_F(Point_test, testHyperbolicDistance)
         }
     }
 }
+
+
+TEST_F(Point_test, testBatchedTerms)
+{
+    // the batch is filled with the fixture's points, very small radii and the boundaries of the quadrants
+    auto batch_radii = std::vector<double>(batch_math::batch_size);
+    auto batch_angles = std::vector<double>(batch_math::batch_size);
+    for (auto k = 0u; k < batch_math::batch_size; ++k) {
+        batch_radii[k] = k % 4 ? radii[k] : std::ldexp(1.0, -static_cast<int>(k / 4));
+        batch_angles[k] = angles[k];
+    }
+    batch_radii[1] = 0.5;
+    batch_radii[2] = std::nextafter(0.5, 1.0);
+    batch_radii[3] = 100.0;
+    for (auto q = 0; q < 4; ++q)
+        batch_angles[q] = q * PI / 2;
+    batch_angles[4] = std::nextafter(2*PI, 0.0);
+
+    auto invsinh_r = std::vector<double>(batch_math::batch_size);
+    auto coth_r = std::vector<double>(batch_math::batch_size);
+    auto cos_phi = std::vector<double>(batch_math::batch_size);
+    auto sin_phi = std::vector<double>(batch_math::batch_size);
+    batch_math::pointTerms(batch_radii.data(), batch_angles.data(), batch_math::batch_size,
+                           invsinh_r.data(), coth_r.data(), cos_phi.data(), sin_phi.data());
+
+    const auto eps = std::numeric_limits<double>::epsilon();
+    for (auto k = 0u; k < batch_math::batch_size; ++k) {
+        const auto r = batch_radii[k];
+        const auto a = batch_angles[k];
+        EXPECT_NEAR(invsinh_r[k], 1.0 / std::sinh(r), 8 * eps / std::sinh(r)) << "r = " << r;
+        EXPECT_NEAR(coth_r[k], std::cosh(r) / std::sinh(r), 8 * eps * std::cosh(r) / std::sinh(r)) << "r = " << r;
+        EXPECT_NEAR(cos_phi[k], std::cos(a), 2 * eps) << "a = " << a;
+        EXPECT_NEAR(sin_phi[k], std::sin(a), 2 * eps) << "a = " << a;
+    }
+
+    // the batched points pass the checks of testDistanceBelowR and testHyperbolicDistance
+    auto batch_points = std::vector<Point<>>(batch_math::batch_size);
+    batch_math::pointTerms(radii.data(), angles.data(), batch_math::batch_size,
+                           invsinh_r.data(), coth_r.data(), cos_phi.data(), sin_phi.data());
+    for (auto k = 0u; k < batch_math::batch_size; ++k)
+        batch_points[k] = Point<>(k, radii[k], angles[k], 0, invsinh_r[k], coth_r[k], cos_phi[k], sin_phi[k]);
+
+    for (auto i = 0u; i < batch_math::batch_size; ++i) {
+        for (auto j = 0u; j < n; ++j) {
+            if (i == j)
+                continue;
+            const auto dist = hyperbolicDistance(radii[i], angles[i], radii[j], angles[j]);
+            ASSERT_EQ(batch_points[i].isDistanceBelowR(points[j], cosh_R), dist < R);
+            ASSERT_NEAR(batch_points[i].hyperbolicDistance(points[j]), dist, 0.000005);
+        }
+    }
+}
@@ -1,9 +1,11 @@
 
+#include <cmath>
 #include <random>
 
 #include <gmock/gmock.h>
 
 #include <hypergirgs/RadiusLayer.h>
+#include <hypergirgs/Generator.h>
 
 
 using namespace std;
@@ -24,3 +26,29 @@ TEST_F(RadiusLayer_test, testKthPoint)
 {
 // TODO implement
 }
+
+
+TEST_F(RadiusLayer_test, testAutoLayerHeight)
+{
+    for (auto n : {1000LL, 1000000LL, 100000000LL}) {
+        for (auto alpha : {0.55, 1.0, 2.0}) {
+            for (auto T : {0.0, 0.5, 0.9}) {
+                const auto R = 2.0 * std::log(static_cast<double>(n));
+                const auto layer_height = RadiusLayer<>::autoLayerHeight(n, alpha, T, R);
+                ASSERT_GE(layer_height, 0.5);
+                ASSERT_LE(layer_height, 4.0);
+            }
+        }
+    }
+
+    // the layers must not be higher than the disc
+    ASSERT_LE(RadiusLayer<>::autoLayerHeight(10, 1.0, 0.0, 0.3), 0.3);
+
+    // for given radii alpha is estimated
+    const auto n = 100000;
+    for (auto alpha : {0.6, 1.0}) {
+        const auto R = hypergirgs::calculateRadius(n, alpha, 0.5, 10);
+        const auto radii = hypergirgs::sampleRadii(n, alpha, R, 12);
+        ASSERT_EQ(RadiusLayer<>::autoLayerHeight(radii, 0.5, R), RadiusLayer<>::autoLayerHeight(n, alpha, 0.5, R)) << "alpha = " << alpha;
+    }
+}